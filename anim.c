@@ -0,0 +1,184 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "red-planet.h"
+#include "json.h"
+#include "anim.h"
+
+static bool read_frames(Atlas* atlas, JsonReader* json);
+static bool read_anims(Atlas* atlas, JsonReader* json);
+static bool read_anim(Animation* anim, JsonReader* json);
+static int read_numbers(JsonReader* json, Uint16 out[], int max_out);
+static bool fail(JsonReader* json, char* path);
+
+// reads an atlas' metadata (the texture is loaded separately); false with
+// SDL_GetError() set if it can't be read or doesn't make sense
+bool atlas_load(Atlas* atlas, char* path) {
+  memset(atlas, 0, sizeof(Atlas));
+
+  size_t len;
+  char* src = read_file(path, &len);
+  if (!src) {
+    SDL_SetError("can't read %s", path);
+    return false;
+  }
+
+  JsonReader json;
+  json_init(&json, src, len);
+  JsonToken t = json_next(&json);
+  bool is_valid = t == JSON_OBJECT;
+  while (is_valid && (t = json_next(&json)) == JSON_KEY) {
+    char key[JSON_MAX_STR];
+    strcpy(key, json.str);
+    t = json_next(&json);
+
+    if (strcmp(key, "image") == 0 && t == JSON_STRING && strlen(json.str) < MAX_ASSET_PATH)
+      strcpy(atlas->image, json.str);
+    else if (strcmp(key, "frames") == 0 && t == JSON_ARRAY)
+      is_valid = read_frames(atlas, &json);
+    else if (strcmp(key, "animations") == 0 && t == JSON_OBJECT)
+      is_valid = read_anims(atlas, &json);
+    else
+      is_valid = json_skip(&json, t);
+  }
+  free(src);
+
+  if (!is_valid || t != JSON_END_OBJECT)
+    return fail(&json, path);
+  if (!atlas->image[0]) {
+    SDL_SetError("%s has no image", path);
+    return false;
+  }
+
+  // (frames may come after the animations that use them)
+  for (int a = 0; a < atlas->num_anims; ++a) {
+    Animation* anim = &atlas->anims[a];
+    for (int f = 0; f < anim->num_frames; ++f) {
+      if (anim->frames[f] >= atlas->num_frames) {
+        SDL_SetError("%s: animation %s uses frame %d, which doesn't exist", path, anim->name, anim->frames[f]);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// the index of the named animation, or ANIM_NONE
+byte atlas_find_anim(Atlas* atlas, char* name) {
+  for (int a = 0; a < atlas->num_anims; ++a)
+    if (strcmp(atlas->anims[a].name, name) == 0)
+      return a;
+  return ANIM_NONE;
+}
+
+// moves every animated entity in the pool dt_ms further through its animation
+void anim_advance(Atlas* atlas, Pool* pool, float dt_ms) {
+  if (!atlas->num_anims)
+    return;
+
+  for (int i = 0; i < pool->count; ++i) {
+    if (pool->anim[i] >= atlas->num_anims)
+      continue;
+
+    Animation* anim = &atlas->anims[pool->anim[i]];
+    int step = pool->anim_step[i];
+    float time = pool->anim_time[i] + dt_ms;
+    while (time >= anim->durations[step]) {
+      if (step == anim->num_frames - 1 && !anim->loop) {
+        time = anim->durations[step]; // done: hold the last step
+        break;
+      }
+      time -= anim->durations[step];
+      step = step == anim->num_frames - 1 ? 0 : step + 1;
+    }
+    pool->anim_step[i] = step;
+    pool->anim_time[i] = time;
+  }
+}
+
+// the atlas rect entity i is showing, or NULL if it isn't animated
+SDL_Rect* anim_frame(Atlas* atlas, Pool* pool, int i) {
+  if (pool->anim[i] >= atlas->num_anims || !atlas->tex)
+    return NULL;
+  Animation* anim = &atlas->anims[pool->anim[i]];
+  return &atlas->frames[anim->frames[pool->anim_step[i]]];
+}
+
+// [[x, y, w, h], ...]
+static bool read_frames(Atlas* atlas, JsonReader* json) {
+  JsonToken t;
+  while ((t = json_next(json)) == JSON_ARRAY) {
+    Uint16 rect[4];
+    if (atlas->num_frames == MAX_ATLAS_FRAMES || read_numbers(json, rect, 4) != 4)
+      return false;
+    atlas->frames[atlas->num_frames++] = (SDL_Rect){rect[0], rect[1], rect[2], rect[3]};
+  }
+  return t == JSON_END_ARRAY;
+}
+
+// {"name": {...}, ...}
+static bool read_anims(Atlas* atlas, JsonReader* json) {
+  JsonToken t;
+  while ((t = json_next(json)) == JSON_KEY) {
+    if (atlas->num_anims == MAX_ANIMS || strlen(json->str) >= MAX_ANIM_NAME)
+      return false;
+
+    Animation* anim = &atlas->anims[atlas->num_anims++];
+    strcpy(anim->name, json->str);
+    if (json_next(json) != JSON_OBJECT || !read_anim(anim, json))
+      return false;
+  }
+  return t == JSON_END_OBJECT;
+}
+
+// {"loop": true, "frames": [...], "durations": [...]}
+static bool read_anim(Animation* anim, JsonReader* json) {
+  anim->loop = true;
+  int num_durations = 0;
+
+  JsonToken t;
+  while ((t = json_next(json)) == JSON_KEY) {
+    char key[JSON_MAX_STR];
+    strcpy(key, json->str);
+    t = json_next(json);
+
+    if (strcmp(key, "loop") == 0 && (t == JSON_TRUE || t == JSON_FALSE))
+      anim->loop = t == JSON_TRUE;
+    else if (strcmp(key, "frames") == 0 && t == JSON_ARRAY)
+      anim->num_frames = read_numbers(json, anim->frames, MAX_ANIM_FRAMES);
+    else if (strcmp(key, "durations") == 0 && t == JSON_ARRAY)
+      num_durations = read_numbers(json, anim->durations, MAX_ANIM_FRAMES);
+    else if (!json_skip(json, t))
+      return false;
+
+    if (anim->num_frames < 0 || num_durations < 0)
+      return false;
+  }
+
+  // every step needs a duration, & a 0 one would never be left
+  if (t != JSON_END_OBJECT || anim->num_frames < 1 || num_durations != anim->num_frames)
+    return false;
+  for (int f = 0; f < anim->num_frames; ++f)
+    if (!anim->durations[f])
+      anim->durations[f] = 1;
+  return true;
+}
+
+// reads the rest of an array of (0-65535) numbers; returns how many, or -1 if
+// there are too many or it holds anything else
+static int read_numbers(JsonReader* json, Uint16 out[], int max_out) {
+  int num = 0;
+  JsonToken t;
+  while ((t = json_next(json)) == JSON_NUMBER) {
+    if (num == max_out || json->num < 0 || json->num > 65535)
+      return -1;
+    out[num++] = json->num;
+  }
+  return t == JSON_END_ARRAY ? num : -1;
+}
+
+static bool fail(JsonReader* json, char* path) {
+  SDL_SetError("%s isn't a valid atlas (%s)", path, json->err[0] ? json->err : "unexpected value");
+  return false;
+}
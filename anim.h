@@ -0,0 +1,55 @@
+#ifndef ANIM_H
+#define ANIM_H
+
+#include <stdbool.h>
+
+#include "SDL.h"
+#include "pool.h"
+#include "assets.h"
+
+// Sprite animation from a texture atlas.
+//
+// tools/atlas packs the frames offline into one image & writes a metadata
+// table: every frame's rect in the image, and for every animation its frames
+// & how long each is shown. The game loads the table once; the durations are
+// already in the form update() steps through, so advancing an entity is a
+// compare or two per tick.
+//
+// Each entity in a pool has an animation (ANIM_NONE = the plain spritesheet
+// sprite), the step it's on & how long it's been on it. Animations named
+// after an entity kind ("player", "enemy", "bullet", "collectable", "weapon")
+// are what that kind's entities start with.
+//
+// Metadata (JSON):
+//   {"image": "example/atlas.png",
+//    "frames": [[x, y, w, h], ...],
+//    "animations": {"player": {"loop": true, "frames": [0, 1], "durations": [100, 150]}, ...}}
+
+#define MAX_ATLAS_FRAMES 1024
+#define MAX_ANIMS 64
+#define MAX_ANIM_FRAMES 32
+#define MAX_ANIM_NAME 32
+
+typedef struct {
+  char name[MAX_ANIM_NAME];
+  int num_frames;
+  Uint16 frames[MAX_ANIM_FRAMES];     // atlas frame shown at each step
+  Uint16 durations[MAX_ANIM_FRAMES];  // ms each step is shown for
+  bool loop;                          // otherwise it holds the last step
+} Animation;
+
+typedef struct {
+  char image[MAX_ASSET_PATH];
+  SDL_Texture* tex;
+  SDL_Rect frames[MAX_ATLAS_FRAMES];
+  int num_frames;
+  Animation anims[MAX_ANIMS];
+  int num_anims;
+} Atlas;
+
+bool atlas_load(Atlas* atlas, char* path);
+byte atlas_find_anim(Atlas* atlas, char* name);
+void anim_advance(Atlas* atlas, Pool* pool, float dt_ms);
+SDL_Rect* anim_frame(Atlas* atlas, Pool* pool, int i);
+
+#endif
@@ -0,0 +1,71 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "SDL.h"
+#include "red-planet.h"
+#include "arena.h"
+
+static ArenaBlock* new_block(ArenaBlock* prev, size_t size);
+static Uint8* block_data(ArenaBlock* block);
+
+void arena_init(Arena* arena, size_t block_size) {
+  arena->block = NULL;
+  arena->block_size = block_size;
+  arena->used = 0;
+}
+
+// returns ARENA_ALIGN-aligned (uninitialized) memory that lives until the next reset
+void* arena_alloc(Arena* arena, size_t size) {
+  ArenaBlock* block = arena->block;
+  size_t start = block ? (block->used + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1) : 0;
+  if (!block || start + size > block->size) {
+    size_t block_size = size > arena->block_size ? size : arena->block_size;
+    block = arena->block = new_block(block, block_size);
+    start = 0;
+  }
+
+  // counting whole cache lines makes `used` enough for a single block to hold everything
+  arena->used += (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+  block->used = start + size;
+  return block_data(block) + start;
+}
+
+// frees everything allocated since the last reset
+void arena_reset(Arena* arena) {
+  if (arena->block && arena->block->prev) {
+    // coalesce: one block that fits this level's high-water mark
+    size_t size = arena->used;
+    arena_free(arena);
+    arena->block = new_block(NULL, size > arena->block_size ? size : arena->block_size);
+  }
+
+  if (arena->block)
+    arena->block->used = 0;
+  arena->used = 0;
+}
+
+void arena_free(Arena* arena) {
+  while (arena->block) {
+    ArenaBlock* prev = arena->block->prev;
+    free(arena->block);
+    arena->block = prev;
+  }
+  arena->used = 0;
+}
+
+static ArenaBlock* new_block(ArenaBlock* prev, size_t size) {
+  // room for the header & for aligning the start of the data
+  ArenaBlock* block = malloc(sizeof(ArenaBlock) + ARENA_ALIGN + size);
+  if (!block)
+    error("allocating level memory");
+
+  block->prev = prev;
+  block->size = size;
+  block->used = 0;
+  return block;
+}
+
+static Uint8* block_data(ArenaBlock* block) {
+  uintptr_t data = (uintptr_t)(block + 1);
+  return (Uint8*)((data + ARENA_ALIGN - 1) & ~(uintptr_t)(ARENA_ALIGN - 1));
+}
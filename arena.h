@@ -0,0 +1,35 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Per-level bump allocator.
+//
+// Allocations are cache-line aligned and are never freed individually: the
+// whole arena is reset at once when the level ends. Memory comes from large
+// blocks; a reset that finds more than one block replaces them with a single
+// block big enough for everything the level used, so later levels of a similar
+// size allocate nothing and nothing fragments between levels.
+//
+// Not thread safe: allocate on the game loop's thread only.
+
+#define ARENA_ALIGN 64
+
+typedef struct ArenaBlock {
+  struct ArenaBlock* prev;
+  size_t size;              // usable bytes
+  size_t used;
+} ArenaBlock;
+
+typedef struct {
+  ArenaBlock* block;        // the one being allocated from; older ones chain through prev
+  size_t block_size;        // minimum size of a new block
+  size_t used;              // across all blocks, in whole cache lines
+} Arena;
+
+void arena_init(Arena* arena, size_t block_size);
+void* arena_alloc(Arena* arena, size_t size);
+void arena_reset(Arena* arena);
+void arena_free(Arena* arena);
+
+#endif
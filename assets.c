@@ -0,0 +1,238 @@
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "SDL.h"
+#include "SDL_image.h"
+#include "red-planet.h"
+#include "assets.h"
+
+#define MAX_TEXTURES 64
+
+typedef struct {
+  char path[MAX_ASSET_PATH];
+  SDL_Texture* tex;
+} CachedTexture;
+
+static const Uint8* pack_data = NULL;
+static size_t pack_len = 0;
+static PackEntry* pack_entries = NULL;
+static int pack_num_entries = 0;
+#ifdef _WIN32
+static HANDLE pack_file = INVALID_HANDLE_VALUE;
+static HANDLE pack_mapping = NULL;
+#endif
+
+static CachedTexture textures[MAX_TEXTURES];
+static int num_textures = 0;
+static SDL_Renderer* textures_renderer = NULL;
+
+static bool map_file(char* path);
+static void unmap_file();
+static PackEntry* pack_find(char* name);
+static SDL_Texture* upload_entry(SDL_Renderer* renderer, PackEntry* entry);
+static SDL_Texture* find_texture(SDL_Renderer* renderer, char* path);
+static SDL_Texture* add_texture(char* path, SDL_Texture* tex);
+
+// maps the pack & checks its index; on failure (incl. a missing file) no pack is used
+bool pack_open(char* path) {
+  pack_close();
+  if (!map_file(path)) {
+    SDL_SetError("can't map %s", path);
+    return false;
+  }
+
+  PackHeader* header = (PackHeader*)pack_data;
+  if (pack_len < sizeof(PackHeader) || header->magic != PACK_MAGIC || header->version != PACK_VERSION) {
+    SDL_SetError("%s isn't a version %d asset pack", path, PACK_VERSION);
+    pack_close();
+    return false;
+  }
+
+  size_t index_end = sizeof(PackHeader) + (size_t)header->num_entries * sizeof(PackEntry);
+  if (index_end > pack_len) {
+    SDL_SetError("%s is truncated", path);
+    pack_close();
+    return false;
+  }
+
+  pack_entries = (PackEntry*)(pack_data + sizeof(PackHeader));
+  pack_num_entries = header->num_entries;
+  for (int i = 0; i < pack_num_entries; ++i) {
+    PackEntry* entry = &pack_entries[i];
+    if (entry->offset < index_end || entry->offset + (Uint64)entry->pitch * entry->h > pack_len || entry->pitch < entry->w * 4) {
+      SDL_SetError("%s has a bad entry for %.*s", path, MAX_ASSET_PATH, entry->name);
+      pack_close();
+      return false;
+    }
+  }
+  return true;
+}
+
+void pack_close() {
+  if (pack_data)
+    unmap_file();
+  pack_data = NULL;
+  pack_len = 0;
+  pack_entries = NULL;
+  pack_num_entries = 0;
+}
+
+bool pack_has(char* path) {
+  return pack_find(path) != NULL;
+}
+
+// returns the (cached) texture for the image, from the pack if it's there,
+// otherwise decoded from disk. The cache owns it; free_textures() destroys it.
+SDL_Texture* load_texture(SDL_Renderer* renderer, char* path) {
+  SDL_Texture* tex = find_texture(renderer, path);
+  if (tex)
+    return tex;
+
+  PackEntry* entry = pack_find(path);
+  tex = entry ? upload_entry(renderer, entry) : IMG_LoadTexture(renderer, path);
+  return tex ? add_texture(path, tex) : NULL;
+}
+
+// like load_texture(), but for an image that's already been decoded (e.g. on
+// a loader thread); the surface is left to the caller
+SDL_Texture* cache_surface(SDL_Renderer* renderer, char* path, SDL_Surface* surface) {
+  SDL_Texture* tex = find_texture(renderer, path);
+  if (tex)
+    return tex;
+
+  tex = SDL_CreateTextureFromSurface(renderer, surface);
+  return tex ? add_texture(path, tex) : NULL;
+}
+
+void free_textures() {
+  for (int i = 0; i < num_textures; ++i)
+    SDL_DestroyTexture(textures[i].tex);
+  num_textures = 0;
+  textures_renderer = NULL;
+}
+
+static PackEntry* pack_find(char* name) {
+  for (int i = 0; i < pack_num_entries; ++i)
+    if (strncmp(pack_entries[i].name, name, MAX_ASSET_PATH) == 0)
+      return &pack_entries[i];
+  return NULL;
+}
+
+static SDL_Texture* find_texture(SDL_Renderer* renderer, char* path) {
+  // textures belong to a renderer, so a new renderer starts a new cache
+  if (renderer != textures_renderer) {
+    free_textures();
+    textures_renderer = renderer;
+  }
+
+  for (int i = 0; i < num_textures; ++i)
+    if (strcmp(textures[i].path, path) == 0)
+      return textures[i].tex;
+  return NULL;
+}
+
+static SDL_Texture* add_texture(char* path, SDL_Texture* tex) {
+  if (strlen(path) >= MAX_ASSET_PATH || num_textures == MAX_TEXTURES) {
+    SDL_SetError("can't cache %s (path too long or more than %d textures)", path, MAX_TEXTURES);
+    SDL_DestroyTexture(tex);
+    return NULL;
+  }
+
+  strcpy(textures[num_textures].path, path);
+  textures[num_textures].tex = tex;
+  num_textures++;
+  return tex;
+}
+
+// the pixels are already in the texture's format, so this is a straight upload
+// from the mapped file
+static SDL_Texture* upload_entry(SDL_Renderer* renderer, PackEntry* entry) {
+  SDL_Texture* tex = SDL_CreateTexture(renderer, entry->format, SDL_TEXTUREACCESS_STATIC, entry->w, entry->h);
+  if (!tex)
+    return NULL;
+
+  if (SDL_UpdateTexture(tex, NULL, pack_data + entry->offset, entry->pitch) < 0 || SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND) < 0) {
+    SDL_DestroyTexture(tex);
+    return NULL;
+  }
+  return tex;
+}
+
+#ifdef _WIN32
+
+static bool map_file(char* path) {
+  pack_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (pack_file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(pack_file, &size) || size.QuadPart == 0)
+    goto fail;
+
+  pack_mapping = CreateFileMappingA(pack_file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!pack_mapping)
+    goto fail;
+
+  pack_data = MapViewOfFile(pack_mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!pack_data)
+    goto fail;
+
+  pack_len = size.QuadPart;
+  return true;
+
+fail:
+  unmap_file();
+  return false;
+}
+
+static void unmap_file() {
+  if (pack_data)
+    UnmapViewOfFile(pack_data);
+  if (pack_mapping)
+    CloseHandle(pack_mapping);
+  if (pack_file != INVALID_HANDLE_VALUE)
+    CloseHandle(pack_file);
+  pack_data = NULL;
+  pack_mapping = NULL;
+  pack_file = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+static bool map_file(char* path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+
+  // the mapping stays valid after the descriptor is closed
+  void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+
+  // everything in the pack gets uploaded, so start reading it in now
+  madvise(data, st.st_size, MADV_WILLNEED);
+  pack_data = data;
+  pack_len = st.st_size;
+  return true;
+}
+
+static void unmap_file() {
+  munmap((void*)pack_data, pack_len);
+}
+
+#endif
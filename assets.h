@@ -0,0 +1,52 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <stdbool.h>
+
+#include "SDL.h"
+
+// Image loading, with an optional pre-built asset pack.
+//
+// tools/pack decodes images offline into a single pack file of raw pixels in
+// PACK_FORMAT (which every SDL2 render backend takes as-is). At runtime the
+// pack is mmap'd and textures are uploaded straight from the mapping, with no
+// decoding & no copy. Images that aren't in the pack are loaded from disk.
+//
+// Every texture is cached by path for the life of the game, so entering a
+// level again doesn't reload anything.
+//
+// Pack layout (native byte order):
+//   PackHeader
+//   PackEntry[num_entries]
+//   pixels, each image starting at a PACK_ALIGN-byte boundary
+
+#define PACK_MAGIC 0x4B415052 // "RPAK"
+#define PACK_VERSION 1
+#define PACK_ALIGN 64
+#define PACK_FORMAT SDL_PIXELFORMAT_ARGB8888
+#define MAX_ASSET_PATH 256
+
+typedef struct {
+  Uint32 magic;
+  Uint32 version;
+  Uint32 num_entries;
+  Uint32 reserved;
+} PackHeader;
+
+typedef struct {
+  char name[MAX_ASSET_PATH]; // the path the image was packed from, e.g. "example/title.png"
+  Uint32 format;
+  Uint32 w;
+  Uint32 h;
+  Uint32 pitch;
+  Uint64 offset;             // of the pixels, from the start of the file
+} PackEntry;
+
+bool pack_open(char* path);
+void pack_close();
+bool pack_has(char* path);
+SDL_Texture* load_texture(SDL_Renderer* renderer, char* path);
+SDL_Texture* cache_surface(SDL_Renderer* renderer, char* path, SDL_Surface* surface);
+void free_textures();
+
+#endif
@@ -0,0 +1,175 @@
+#include <stdio.h>
+
+#include "SDL.h"
+#include "SDL_mixer.h"
+#include "red-planet.h"
+#include "loader.h"
+#include "audio.h"
+
+typedef struct {
+  char* path;           // NULL = no file yet (never loaded or played)
+  int max_voices;
+  int priority;         // higher steals from lower
+  Mix_Chunk* chunk;     // NULL if it didn't load (it's then never played)
+} Sound;
+
+typedef struct {
+  int effect;           // -1 = never used
+  Uint32 started;       // SDL_GetTicks()
+} Voice;
+
+// bounded multi-producer, single-consumer queue: each cell's seq says whether
+// it's free for the producer at that position or full for the consumer
+typedef struct {
+  SDL_atomic_t seq;
+  int effect;
+} QueueCell;
+
+// none of the effects have files yet, so they're all off (NULL path) for now;
+// give one its path (e.g. "audio/tower_shoot.wav") once the file is added
+static Sound sounds[NUM_SND_EFFECTS] = {
+  [SND_TOWER_SHOOT] =     {NULL, 4, 1},
+  [SND_TOWER_DAMAGE] =    {NULL, 3, 2},
+  [SND_BEAST_DAMAGE] =    {NULL, 4, 0},
+  [SND_ENTITY_ENABLED] =  {NULL, 2, 2},
+  [SND_TOWER_EXPLOSION] = {NULL, 2, 3},
+  [SND_LEVELUP] =         {NULL, 1, 4}
+};
+
+static Voice voices[MAX_VOICES];
+static QueueCell queue[SOUND_QUEUE_SIZE];
+static SDL_atomic_t queue_tail = {};
+static int queue_head = 0; // only touched by audio_update()
+static bool is_open = false;
+
+static int find_voice(SoundEffect effect);
+
+// opens the mixer with an audio_buffer-sample buffer (rounded up to a power of 2)
+void audio_init() {
+  int samples = 256;
+  while (samples < audio_buffer)
+    samples *= 2;
+  if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, samples) < 0)
+    error("opening audio device");
+  Mix_AllocateChannels(MAX_VOICES);
+
+  for (int v = 0; v < MAX_VOICES; ++v)
+    voices[v].effect = -1;
+  for (int i = 0; i < SOUND_QUEUE_SIZE; ++i)
+    SDL_AtomicSet(&queue[i].seq, i);
+  is_open = true;
+}
+
+// queues the effects that have a file on the loader (ones that fail to load are
+// skipped with a warning, once)
+void audio_load() {
+  for (int s = 0; s < NUM_SND_EFFECTS; ++s)
+    if (sounds[s].path)
+      load_sound_async(&sounds[s].chunk, sounds[s].path);
+}
+
+// queues an effect to start on the next audio_update(); false if the queue's full
+bool play_sound(SoundEffect effect) {
+  int pos = SDL_AtomicGet(&queue_tail);
+  for (;;) {
+    QueueCell* cell = &queue[pos & (SOUND_QUEUE_SIZE - 1)];
+    int diff = SDL_AtomicGet(&cell->seq) - pos;
+    if (diff < 0)
+      return false;
+
+    if (diff == 0 && SDL_AtomicCAS(&queue_tail, pos, pos + 1)) {
+      cell->effect = effect;
+      SDL_MemoryBarrierRelease();
+      SDL_AtomicSet(&cell->seq, pos + 1); // publishes the effect
+      return true;
+    }
+    pos = SDL_AtomicGet(&queue_tail);
+  }
+}
+
+// starts the sounds requested since the last call (on the main thread, once a frame)
+void audio_update() {
+  bool requested[NUM_SND_EFFECTS] = {};
+  for (;;) {
+    QueueCell* cell = &queue[queue_head & (SOUND_QUEUE_SIZE - 1)];
+    if (SDL_AtomicGet(&cell->seq) != queue_head + 1)
+      break;
+
+    SDL_MemoryBarrierAcquire();
+    requested[cell->effect] = true;
+    SDL_AtomicSet(&cell->seq, queue_head + SOUND_QUEUE_SIZE); // free for the lap after next
+    queue_head++;
+  }
+
+  if (!is_open)
+    return;
+
+  // each effect plays at most once a frame, however often it was requested;
+  // ones without a chunk (no file, or it failed to load) are quietly skipped
+  Uint32 now = SDL_GetTicks();
+  for (int s = 0; s < NUM_SND_EFFECTS; ++s) {
+    if (!requested[s] || !sounds[s].chunk)
+      continue;
+
+    int v = find_voice(s);
+    if (v < 0)
+      continue;
+
+    if (Mix_PlayChannel(v, sounds[s].chunk, 0) < 0) {
+      printf("playing %s failed: %s\n", sounds[s].path, Mix_GetError());
+      continue;
+    }
+    voices[v].effect = s;
+    voices[v].started = now;
+  }
+}
+
+void audio_quit() {
+  if (is_open) {
+    Mix_HaltChannel(-1);
+    Mix_CloseAudio();
+  }
+  is_open = false;
+
+  for (int s = 0; s < NUM_SND_EFFECTS; ++s) {
+    if (sounds[s].chunk)
+      Mix_FreeChunk(sounds[s].chunk);
+    sounds[s].chunk = NULL;
+  }
+  Mix_Quit();
+}
+
+// the channel to play an effect on: a free one (unless the effect is at its
+// cap, in which case its own oldest voice), else the oldest voice of the lowest
+// priority that's no higher than the effect's; -1 if everything outranks it
+static int find_voice(SoundEffect effect) {
+  int num_playing = 0;
+  int oldest_own = -1;
+  int free_voice = -1;
+  int steal = -1;
+  for (int v = 0; v < MAX_VOICES; ++v) {
+    if (voices[v].effect < 0 || !Mix_Playing(v)) {
+      if (free_voice < 0)
+        free_voice = v;
+      continue;
+    }
+
+    Voice* voice = &voices[v];
+    if (voice->effect == (int)effect) {
+      num_playing++;
+      if (oldest_own < 0 || voice->started < voices[oldest_own].started)
+        oldest_own = v;
+    }
+
+    int priority = sounds[voice->effect].priority;
+    if (priority > sounds[effect].priority)
+      continue;
+    if (steal < 0 || priority < sounds[voices[steal].effect].priority ||
+        (priority == sounds[voices[steal].effect].priority && voice->started < voices[steal].started))
+      steal = v;
+  }
+
+  if (num_playing >= sounds[effect].max_voices)
+    return oldest_own;
+  return free_voice >= 0 ? free_voice : steal;
+}
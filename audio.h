@@ -0,0 +1,39 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <stdbool.h>
+
+// Sound effects.
+//
+// play_sound() can be called from any thread (update jobs included): it just
+// pushes the request onto a lock-free queue. Once a frame, audio_update() on
+// the main thread drains the queue, merges repeat requests for an effect into
+// a single play & starts the voices. Each effect has a cap on how many of its
+// voices play at once & a priority; a sound that would go over its cap
+// restarts its own oldest voice, and one that finds every channel busy steals
+// the oldest voice of the lowest priority below or equal to its own (or is
+// dropped). The chunks stay loaded for the whole run.
+//
+// audio_buffer (samples, from the config) sets the mixer's latency:
+// 512 samples at 44.1 kHz is ~12 ms; it can go down to 256.
+
+typedef enum {
+  SND_TOWER_SHOOT,
+  SND_TOWER_DAMAGE,
+  SND_BEAST_DAMAGE,
+  SND_ENTITY_ENABLED,
+  SND_TOWER_EXPLOSION,
+  SND_LEVELUP,
+  NUM_SND_EFFECTS
+} SoundEffect;
+
+#define MAX_VOICES 32         // mixer channels
+#define SOUND_QUEUE_SIZE 256  // play requests per frame; must be a power of 2
+
+void audio_init();
+void audio_load();
+bool play_sound(SoundEffect effect);
+void audio_update();
+void audio_quit();
+
+#endif
@@ -0,0 +1,100 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "red-planet.h"
+#include "batch.h"
+
+static void reserve(SpriteBatch* batch, int num_quads);
+
+void batch_begin(SpriteBatch* batch, SDL_Renderer* renderer) {
+  batch->renderer = renderer;
+  batch->tex = NULL;
+  batch->num_quads = 0;
+  batch->num_draws = 0;
+}
+
+// queues the `src` rect of `tex`, drawn into `dest` & tinted by `color`
+void batch_quad(SpriteBatch* batch, SDL_Texture* tex, SDL_Rect* src, SDL_FRect* dest, SDL_Color color) {
+  if (tex != batch->tex) {
+    batch_flush(batch);
+    int w, h;
+    if (SDL_QueryTexture(tex, NULL, NULL, &w, &h) < 0)
+      error("querying batch texture");
+    batch->tex = tex;
+    batch->tex_w = w;
+    batch->tex_h = h;
+  }
+
+  if (batch->num_quads == batch->max_quads)
+    reserve(batch, batch->max_quads ? batch->max_quads * 2 : 1024);
+
+  float u1 = src->x / batch->tex_w;
+  float v1 = src->y / batch->tex_h;
+  float u2 = (src->x + src->w) / batch->tex_w;
+  float v2 = (src->y + src->h) / batch->tex_h;
+  float x2 = dest->x + dest->w;
+  float y2 = dest->y + dest->h;
+
+  SDL_Vertex* vert = &batch->verts[batch->num_quads * 4];
+  vert[0] = (SDL_Vertex){{dest->x, dest->y}, color, {u1, v1}};
+  vert[1] = (SDL_Vertex){{x2, dest->y}, color, {u2, v1}};
+  vert[2] = (SDL_Vertex){{x2, y2}, color, {u2, v2}};
+  vert[3] = (SDL_Vertex){{dest->x, y2}, color, {u1, v2}};
+  batch->num_quads++;
+}
+
+// queues a solid `color` rect (blended with the renderer's draw blend mode)
+void batch_rect(SpriteBatch* batch, SDL_FRect* dest, SDL_Color color) {
+  if (batch->tex) {
+    batch_flush(batch);
+    batch->tex = NULL;
+  }
+
+  if (batch->num_quads == batch->max_quads)
+    reserve(batch, batch->max_quads ? batch->max_quads * 2 : 1024);
+
+  float x2 = dest->x + dest->w;
+  float y2 = dest->y + dest->h;
+
+  SDL_Vertex* vert = &batch->verts[batch->num_quads * 4];
+  vert[0] = (SDL_Vertex){{dest->x, dest->y}, color};
+  vert[1] = (SDL_Vertex){{x2, dest->y}, color};
+  vert[2] = (SDL_Vertex){{x2, y2}, color};
+  vert[3] = (SDL_Vertex){{dest->x, y2}, color};
+  batch->num_quads++;
+}
+
+// submits everything queued so far
+void batch_flush(SpriteBatch* batch) {
+  if (!batch->num_quads)
+    return;
+
+  if (SDL_RenderGeometry(batch->renderer, batch->tex, batch->verts, batch->num_quads * 4, batch->indices, batch->num_quads * 6) < 0)
+    error("rendering sprite batch");
+
+  batch->num_quads = 0;
+  batch->num_draws++;
+}
+
+void batch_free(SpriteBatch* batch) {
+  free(batch->verts);
+  free(batch->indices);
+  memset(batch, 0, sizeof(SpriteBatch));
+}
+
+// grows the buffers; the index pattern is the same for every quad, so it's
+// written once here rather than per quad
+static void reserve(SpriteBatch* batch, int num_quads) {
+  batch->verts = realloc(batch->verts, num_quads * 4 * sizeof(SDL_Vertex));
+  batch->indices = realloc(batch->indices, num_quads * 6 * sizeof(int));
+  if (!batch->verts || !batch->indices)
+    error("allocating sprite batch");
+
+  for (int q = batch->max_quads; q < num_quads; ++q) {
+    int* index = &batch->indices[q * 6];
+    index[0] = q * 4; index[1] = q * 4 + 1; index[2] = q * 4 + 2;
+    index[3] = q * 4; index[4] = q * 4 + 2; index[5] = q * 4 + 3;
+  }
+  batch->max_quads = num_quads;
+}
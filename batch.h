@@ -0,0 +1,30 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "SDL.h"
+
+// Sprite batch: collects textured quads into one vertex/index buffer and
+// submits them with a single SDL_RenderGeometry() call per texture.
+//
+// Quads are flushed when the texture changes or on batch_flush(), so draw
+// order is preserved. Untextured quads (batch_rect()) count as a texture of
+// their own, NULL. The buffers grow as needed and are reused every frame.
+typedef struct {
+  SDL_Renderer* renderer;
+  SDL_Texture* tex;
+  float tex_w;
+  float tex_h;
+  SDL_Vertex* verts;
+  int* indices;
+  int num_quads;
+  int max_quads;
+  int num_draws;    // SDL_RenderGeometry() calls since batch_begin()
+} SpriteBatch;
+
+void batch_begin(SpriteBatch* batch, SDL_Renderer* renderer);
+void batch_quad(SpriteBatch* batch, SDL_Texture* tex, SDL_Rect* src, SDL_FRect* dest, SDL_Color color);
+void batch_rect(SpriteBatch* batch, SDL_FRect* dest, SDL_Color color);
+void batch_flush(SpriteBatch* batch);
+void batch_free(SpriteBatch* batch);
+
+#endif
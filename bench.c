@@ -0,0 +1,532 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "SDL_image.h"
+#include "red-planet.h"
+#include "jobs.h"
+#include "config.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "assets.h"
+#include "loader.h"
+#include "camera.h"
+#include "profiler.h"
+
+// Headless simulation & stress-scenario benchmarks
+//
+// Runs load() + update() with a fixed dt and no window/renderer, with the
+// enemy, bullet & collectable pools filled to each of the requested sizes.
+// Each tick is also snapshotted (& delta'd against the last tick's snapshot),
+// outside the timed update, to report what per-tick snapshots would cost; the
+// last one is restored to check it round-trips.
+//
+// usage: red-planet --bench [--ticks N] [--hz N] [--seed N] [--sizes 100,1000,...] [--threads N]
+//
+// Also replays input logs recorded with --record (see replay.h) the same way,
+// as fast as possible, & checks the final world against the recording's.
+//
+// usage: red-planet --replay session.rpl [--config config.json] [--threads N]
+//
+// And benchmarks render() on SDL's software renderer, drawing into a memory
+// surface (no window, display or GPU): the same scenarios, simulated between
+// frames, with the time spent in render() per frame reported. Frames can be
+// captured (as PNGs, or raw ARGB8888 pixels with a pitch of 4 * width) for
+// golden-image comparisons, & each scenario's last frame is hashed, so a
+// changed hash flags a change in what's drawn without keeping images around.
+// With --profile-out, the split between world, HUD & present goes to the profile.
+//
+// usage: red-planet --render-bench [--frames N] [--size WxH] [--seed N] [--sizes 100,1000,...]
+//                   [--capture-dir DIR] [--capture-every N] [--raw] [--profile-out trace.json|trace.csv]
+
+#define MAX_BENCH_SIZES 16
+
+typedef struct {
+  int ticks;          // (frames, for --render-bench)
+  int hz;
+  unsigned int seed;
+  int sizes[MAX_BENCH_SIZES];
+  int num_sizes;
+  int width;          // render target px
+  int height;
+  char* capture_dir;  // NULL = no captures
+  int capture_every;  // frames; 0 = just each scenario's last
+  bool is_raw;        // capture raw pixels rather than PNGs
+} BenchOptions;
+
+static void parse_sizes(char* str, BenchOptions* opts);
+static void bench_scenario(int size, BenchOptions* opts);
+static void render_scenario(SDL_Renderer* renderer, SDL_Texture* sprites, int size, BenchOptions* opts);
+static Uint32 capture_frame(SDL_Renderer* renderer, BenchOptions* opts, int size, int frame, Uint32* pixels, bool is_saved);
+static void fill_pool(World* world, Pool* pool);
+static void spawn_bullet(World* world, Pool* bullets, int i);
+static int compare_doubles(const void* a, const void* b);
+static double percentile(double sorted[], int num, double pct);
+
+int run_bench(int num_args, char* args[]) {
+  BenchOptions opts = {
+    .ticks = 1000,
+    .hz = 60,
+    .seed = 1529597895,
+    .sizes = {100, 1000, 10000, 100000},
+    .num_sizes = 4
+  };
+
+  for (int i = 0; i < num_args; ++i) {
+    bool has_val = i + 1 < num_args;
+    if (strcmp(args[i], "--ticks") == 0 && has_val)
+      opts.ticks = atoi(args[++i]);
+    else if (strcmp(args[i], "--hz") == 0 && has_val)
+      opts.hz = atoi(args[++i]);
+    else if (strcmp(args[i], "--seed") == 0 && has_val)
+      opts.seed = strtoul(args[++i], NULL, 10);
+    else if (strcmp(args[i], "--sizes") == 0 && has_val)
+      parse_sizes(args[++i], &opts);
+    else if (strcmp(args[i], "--threads") == 0 && has_val)
+      num_job_threads = atoi(args[++i]);
+    else {
+      printf("usage: red-planet --bench [--ticks N] [--hz N] [--seed N] [--sizes 100,1000,...] [--threads N]\n");
+      return 1;
+    }
+  }
+
+  if (opts.ticks < 1 || opts.hz < 1 || opts.num_sizes < 1) {
+    printf("bench: ticks, hz & sizes must all be positive\n");
+    return 1;
+  }
+
+  // only the timer is needed; no window, renderer or audio
+  if (SDL_Init(SDL_INIT_TIMER) < 0)
+    error("initializing SDL");
+  jobs_init(num_job_threads);
+
+  printf("Seed: %u, ticks: %d, dt: 1/%d sec, job threads: %d\n", opts.seed, opts.ticks, opts.hz, jobs_num_threads());
+  printf("%10s %12s %10s %10s %10s %10s %10s %10s\n", "entities", "ticks/sec", "p50 ms", "p99 ms", "max ms", "snap us", "delta KB", "restore us");
+  for (int i = 0; i < opts.num_sizes; ++i)
+    bench_scenario(opts.sizes[i], &opts);
+
+  arena_free(&level_arena);
+  jobs_quit();
+  SDL_Quit();
+  return 0;
+}
+
+// returns 0 if the replay ended in the recorded state, 1 if it desynced (or failed)
+int run_replay(int num_args, char* args[]) {
+  char* path = NULL;
+  for (int i = 0; i < num_args; ++i) {
+    bool has_val = i + 1 < num_args;
+    if (strcmp(args[i], "--config") == 0 && has_val)
+      config_path = args[++i];
+    else if (strcmp(args[i], "--threads") == 0 && has_val)
+      num_job_threads = atoi(args[++i]);
+    else if (!path && args[i][0] != '-')
+      path = args[i];
+    else {
+      path = NULL;
+      break;
+    }
+  }
+  if (!path) {
+    printf("usage: red-planet --replay session.rpl [--config config.json] [--threads N]\n");
+    return 1;
+  }
+
+  // the simulation has to be set up just like the recording's
+  if (!config_load(config_path))
+    printf("Not using a config file (can't read %s)\n", config_path);
+  ReplayHeader header;
+  InputEvent* inputs = replay_load(path, &header);
+  if (!inputs) {
+    printf("replay: %s\n", SDL_GetError());
+    return 1;
+  }
+  tick_rate = header.tick_rate;
+  game_width = header.game_width;
+  game_height = header.game_height;
+
+  if (SDL_Init(SDL_INIT_TIMER) < 0)
+    error("initializing SDL");
+  jobs_init(num_job_threads);
+
+  // (at least 1 sample, so an empty log still reports something)
+  double* samples = calloc(header.num_ticks + 1, sizeof(double));
+  if (!samples)
+    error("allocating replay samples");
+
+  World world;
+  load(&world, header.seed);
+
+  // same order as play_level(): a tick's inputs, then its update
+  double freq = SDL_GetPerformanceFrequency();
+  double total = 0;
+  Uint32 next = 0;
+  for (Uint32 tick = 0; tick < header.num_ticks; ++tick) {
+    while (next < header.num_inputs && inputs[next].tick <= tick)
+      apply_input(&inputs[next++], &world);
+
+    unsigned int tick_start = tick * 1000ull / tick_rate;
+    unsigned int tick_end = (tick + 1) * 1000ull / tick_rate;
+    Uint64 start = SDL_GetPerformanceCounter();
+    update(1.0 / tick_rate, tick_start, tick_end, &world);
+    samples[tick] = (SDL_GetPerformanceCounter() - start) * 1000.0 / freq;
+    total += samples[tick];
+  }
+
+  Uint32 checksum = world_checksum(&world);
+  bool in_sync = checksum == header.checksum;
+  int num_samples = header.num_ticks > 0 ? header.num_ticks : 1;
+  qsort(samples, num_samples, sizeof(double), compare_doubles);
+
+  printf("Seed: %u, ticks: %u, inputs: %u, dt: 1/%u sec, job threads: %d\n", header.seed, header.num_ticks, header.num_inputs, header.tick_rate, jobs_num_threads());
+  printf("%12s %10s %10s %10s %10s\n", "ticks/sec", "total ms", "p50 ms", "p99 ms", "max ms");
+  printf("%12.1f %10.2f %10.4f %10.4f %10.4f\n",
+    total > 0 ? header.num_ticks / (total / 1000.0) : 0,
+    total,
+    percentile(samples, num_samples, 0.50),
+    percentile(samples, num_samples, 0.99),
+    samples[num_samples - 1]);
+  printf("Checksum: %08x (recorded %08x) %s\n", checksum, header.checksum, in_sync ? "in sync" : "DESYNC");
+
+  unload(&world);
+  free(samples);
+  free(inputs);
+  arena_free(&level_arena);
+  jobs_quit();
+  config_quit();
+  SDL_Quit();
+  return in_sync ? 0 : 1;
+}
+
+int run_render_bench(int num_args, char* args[]) {
+  BenchOptions opts = {
+    .ticks = 300,
+    .hz = 60,
+    .seed = 1529597895,
+    .sizes = {100, 1000, 10000},
+    .num_sizes = 3
+  };
+
+  // (the config is read first so the options override it)
+  for (int i = 0; i + 1 < num_args; ++i)
+    if (strcmp(args[i], "--config") == 0)
+      config_path = args[i + 1];
+  if (!config_load(config_path))
+    printf("Not using a config file (can't read %s)\n", config_path);
+  opts.width = game_width;
+  opts.height = game_height;
+
+  for (int i = 0; i < num_args; ++i) {
+    bool has_val = i + 1 < num_args;
+    if (strcmp(args[i], "--frames") == 0 && has_val)
+      opts.ticks = atoi(args[++i]);
+    else if (strcmp(args[i], "--size") == 0 && has_val) {
+      if (sscanf(args[++i], "%dx%d", &opts.width, &opts.height) != 2)
+        opts.width = 0;
+    }
+    else if (strcmp(args[i], "--seed") == 0 && has_val)
+      opts.seed = strtoul(args[++i], NULL, 10);
+    else if (strcmp(args[i], "--sizes") == 0 && has_val)
+      parse_sizes(args[++i], &opts);
+    else if (strcmp(args[i], "--capture-dir") == 0 && has_val)
+      opts.capture_dir = args[++i];
+    else if (strcmp(args[i], "--capture-every") == 0 && has_val)
+      opts.capture_every = atoi(args[++i]);
+    else if (strcmp(args[i], "--raw") == 0)
+      opts.is_raw = true;
+    else if (strcmp(args[i], "--profile-out") == 0 && has_val)
+      profile_out = args[++i];
+    else if (strcmp(args[i], "--config") == 0 && has_val)
+      i++;
+    else {
+      printf("usage: red-planet --render-bench [--frames N] [--size WxH] [--seed N] [--sizes 100,1000,...] [--capture-dir DIR] [--capture-every N] [--raw] [--profile-out trace.json|trace.csv]\n");
+      return 1;
+    }
+  }
+
+  if (opts.ticks < 1 || opts.num_sizes < 1 || opts.width < 1 || opts.height <= header_height || opts.capture_every < 0) {
+    printf("render-bench: frames, sizes & size must all be positive (& the height more than the header's)\n");
+    return 1;
+  }
+
+  // the software renderer draws into a plain surface, so no video subsystem
+  // (or display) is needed
+  if (SDL_Init(SDL_INIT_TIMER) < 0)
+    error("initializing SDL");
+  jobs_init(num_job_threads);
+
+  SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, opts.width, opts.height, 32, SDL_PIXELFORMAT_ARGB8888);
+  if (!target)
+    error("creating render target");
+  SDL_Renderer* renderer = SDL_CreateSoftwareRenderer(target);
+  if (!renderer)
+    error("creating software renderer");
+  if (SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND) < 0)
+    error("setting blend mode");
+
+  vp = (Viewport){.w = opts.width, .h = opts.height - header_height};
+
+  // the same images the game draws with, loaded the same way
+  if (!pack_open(pack_path))
+    printf("Not using asset pack (%s)\n", SDL_GetError());
+  loader_init();
+  load_level_assets();
+  while (!loader_poll(renderer))
+    SDL_Delay(1);
+  SDL_Texture* sprites = load_texture(renderer, spritesheet);
+  if (!sprites)
+    error("loading image");
+
+  printf("Seed: %u, frames: %d, %dx%d software renderer\n", opts.seed, opts.ticks, opts.width, opts.height);
+  printf("%10s %12s %10s %10s %10s %10s\n", "entities", "frames/sec", "p50 ms", "p99 ms", "max ms", "hash");
+  for (int i = 0; i < opts.num_sizes; ++i)
+    render_scenario(renderer, sprites, opts.sizes[i], &opts);
+
+  if (profile_out && !prof_dump(profile_out))
+    printf("writing profile to %s failed\n", profile_out);
+
+  loader_quit();
+  jobs_quit();
+  config_quit();
+  arena_free(&level_arena);
+  free_graphics();
+  pack_close();
+  SDL_DestroyRenderer(renderer);
+  SDL_FreeSurface(target);
+  SDL_Quit();
+  return 0;
+}
+
+static void parse_sizes(char* str, BenchOptions* opts) {
+  opts->num_sizes = 0;
+  for (char* tok = strtok(str, ","); tok && opts->num_sizes < MAX_BENCH_SIZES; tok = strtok(NULL, ",")) {
+    int size = atoi(tok);
+    if (size > 0)
+      opts->sizes[opts->num_sizes++] = size;
+  }
+}
+
+// fills the enemy, bullet & collectable pools to `size` and times `ticks` fixed-dt updates
+static void bench_scenario(int size, BenchOptions* opts) {
+  int saved_enemies = max_enemies;
+  int saved_bullets = max_bullets;
+  int saved_collectables = max_collectables;
+  max_enemies = max_bullets = max_collectables = size;
+
+  double* samples = malloc(opts->ticks * sizeof(double));
+  if (!samples)
+    error("allocating bench samples");
+
+  World world;
+  load(&world, opts->seed);
+  fill_pool(&world, &world.enemies);
+  fill_pool(&world, &world.bullets);
+  fill_pool(&world, &world.collectables);
+
+  // this tick's snapshot & the last one (alternating), & the delta between them
+  Snapshot snaps[2] = {};
+  Snapshot delta = {};
+  double snap_total = 0;
+  double delta_total = 0;
+
+  double dt = 1.0 / opts->hz;
+  double freq = SDL_GetPerformanceFrequency();
+  double total = 0;
+  for (int tick = 0; tick < opts->ticks; ++tick) {
+    unsigned int last_loop_time = (unsigned int)(tick * 1000.0 / opts->hz);
+    unsigned int curr_time = (unsigned int)((tick + 1) * 1000.0 / opts->hz);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    update(dt, last_loop_time, curr_time, &world);
+    Uint64 end = SDL_GetPerformanceCounter();
+
+    samples[tick] = (end - start) * 1000.0 / freq;
+    total += samples[tick];
+
+    // keep the bullet pool saturated (outside of the timed region)
+    int b;
+    while ((b = pool_spawn(&world.bullets)) != -1)
+      spawn_bullet(&world, &world.bullets, b);
+
+    start = SDL_GetPerformanceCounter();
+    Snapshot* snap = &snaps[tick % 2];
+    snapshot_take(snap, &world);
+    snapshot_delta(&delta, snap, &snaps[(tick + 1) % 2]);
+    snap_total += (SDL_GetPerformanceCounter() - start) * 1000000.0 / freq;
+    delta_total += delta.len;
+  }
+
+  // one more tick, then back to the last snapshot, which should put the world
+  // exactly where it was
+  Uint32 checksum = world_checksum(&world);
+  update(dt, 0, 0, &world);
+  Uint64 start = SDL_GetPerformanceCounter();
+  if (!snapshot_restore(&snaps[(opts->ticks - 1) % 2], &world))
+    printf("bench: %s\n", SDL_GetError());
+  double restore_us = (SDL_GetPerformanceCounter() - start) * 1000000.0 / freq;
+  if (world_checksum(&world) != checksum)
+    printf("bench: restoring a snapshot didn't give back the same world\n");
+
+  snapshot_free(&snaps[0]);
+  snapshot_free(&snaps[1]);
+  snapshot_free(&delta);
+  unload(&world);
+  qsort(samples, opts->ticks, sizeof(double), compare_doubles);
+  printf("%10d %12.1f %10.4f %10.4f %10.4f %10.1f %10.1f %10.1f\n", size,
+    total > 0 ? opts->ticks / (total / 1000.0) : 0,
+    percentile(samples, opts->ticks, 0.50),
+    percentile(samples, opts->ticks, 0.99),
+    samples[opts->ticks - 1],
+    snap_total / opts->ticks,
+    delta_total / opts->ticks / 1024,
+    restore_us);
+
+  free(samples);
+
+  max_enemies = saved_enemies;
+  max_bullets = saved_bullets;
+  max_collectables = saved_collectables;
+}
+
+// fills the pools like bench_scenario() & times render() for `ticks` frames,
+// running a tick of the simulation (untimed) before each
+static void render_scenario(SDL_Renderer* renderer, SDL_Texture* sprites, int size, BenchOptions* opts) {
+  int saved_enemies = max_enemies;
+  int saved_bullets = max_bullets;
+  int saved_collectables = max_collectables;
+  max_enemies = max_bullets = max_collectables = size;
+
+  double* samples = malloc(opts->ticks * sizeof(double));
+  Uint32* pixels = malloc((size_t)opts->width * opts->height * sizeof(Uint32));
+  if (!samples || !pixels)
+    error("allocating render bench buffers");
+
+  World world;
+  load(&world, opts->seed);
+  fill_pool(&world, &world.enemies);
+  fill_pool(&world, &world.bullets);
+  fill_pool(&world, &world.collectables);
+  Camera bench_camera = {}; // (its own, so the game's camera is left alone)
+
+  // frames are drawn halfway between ticks, at the clock's simulated time,
+  // so every run draws exactly the same frames
+  double dt = 1.0 / opts->hz;
+  double freq = SDL_GetPerformanceFrequency();
+  double total = 0;
+  Uint32 hash = 0;
+  for (int frame = 0; frame < opts->ticks; ++frame) {
+    update(dt, frame * 1000 / opts->hz, (frame + 1) * 1000 / opts->hz, &world);
+    int b;
+    while ((b = pool_spawn(&world.bullets)) != -1)
+      spawn_bullet(&world, &world.bullets, b);
+    camera_update(&bench_camera, &vp, &world.players, 0.5, dt);
+
+    prof_begin_frame();
+    Uint64 start = SDL_GetPerformanceCounter();
+    render(renderer, sprites, &world, 0.5, frame * 1000 / opts->hz);
+    Uint64 end = SDL_GetPerformanceCounter();
+    prof_end_frame();
+
+    samples[frame] = (end - start) * 1000.0 / freq;
+    total += samples[frame];
+
+    bool is_last = frame == opts->ticks - 1;
+    bool is_saved = opts->capture_dir && (is_last || (opts->capture_every && frame % opts->capture_every == 0));
+    if (is_last || is_saved)
+      hash = capture_frame(renderer, opts, size, frame, pixels, is_saved);
+  }
+
+  unload(&world);
+  qsort(samples, opts->ticks, sizeof(double), compare_doubles);
+  printf("%10d %12.1f %10.4f %10.4f %10.4f   %08x\n", size,
+    total > 0 ? opts->ticks / (total / 1000.0) : 0,
+    percentile(samples, opts->ticks, 0.50),
+    percentile(samples, opts->ticks, 0.99),
+    samples[opts->ticks - 1],
+    hash);
+
+  free(samples);
+  free(pixels);
+
+  max_enemies = saved_enemies;
+  max_bullets = saved_bullets;
+  max_collectables = saved_collectables;
+}
+
+// reads back the frame just drawn, writes it to the capture dir if `is_saved`
+// & returns its FNV-1a hash
+static Uint32 capture_frame(SDL_Renderer* renderer, BenchOptions* opts, int size, int frame, Uint32* pixels, bool is_saved) {
+  int pitch = opts->width * sizeof(Uint32);
+  if (SDL_RenderReadPixels(renderer, NULL, SDL_PIXELFORMAT_ARGB8888, pixels, pitch) < 0)
+    error("reading back frame");
+
+  Uint32 hash = 2166136261u;
+  Uint8* bytes = (Uint8*)pixels;
+  for (size_t i = 0; i < (size_t)pitch * opts->height; ++i)
+    hash = (hash ^ bytes[i]) * 16777619u;
+  if (!is_saved)
+    return hash;
+
+  char path[1024];
+  snprintf(path, sizeof(path), "%s/render-%d-%04d.%s", opts->capture_dir, size, frame, opts->is_raw ? "argb" : "png");
+  if (opts->is_raw) {
+    FILE* file = fopen(path, "wb");
+    bool is_written = file && fwrite(pixels, pitch, opts->height, file) == (size_t)opts->height;
+    if (file && fclose(file) != 0)
+      is_written = false;
+    if (!is_written)
+      printf("writing %s failed\n", path);
+    return hash;
+  }
+
+  SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(pixels, opts->width, opts->height, 32, pitch, SDL_PIXELFORMAT_ARGB8888);
+  if (!surface)
+    error("wrapping captured frame");
+  if (IMG_SavePNG(surface, path) < 0)
+    printf("writing %s failed (%s)\n", path, SDL_GetError());
+  SDL_FreeSurface(surface);
+  return hash;
+}
+
+static void fill_pool(World* world, Pool* pool) {
+  int i;
+  while ((i = pool_spawn(pool)) != -1) {
+    if (pool->kind == BULLET) {
+      spawn_bullet(world, pool, i);
+      continue;
+    }
+
+    pool->health[i] = 3;
+    pool->x[i] = world_rand(world) % game_width;
+    pool->y[i] = world_rand(world) % game_height;
+  }
+}
+
+static void spawn_bullet(World* world, Pool* bullets, int i) {
+  bullets->health[i] = 1;
+  bullets->x[i] = world_rand(world) % game_width;
+  bullets->y[i] = world_rand(world) % game_height;
+
+  // any of the 8 directions (a stationary bullet would never be culled)
+  int dx, dy;
+  do {
+    dx = (int)(world_rand(world) % 3) - 1;
+    dy = (int)(world_rand(world) % 3) - 1;
+  } while (dx == 0 && dy == 0);
+  bullets->dx[i] = dx;
+  bullets->dy[i] = dy;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+  double da = *(const double*)a;
+  double db = *(const double*)b;
+  return (da > db) - (da < db);
+}
+
+// nearest-rank percentile of an ascending array
+static double percentile(double sorted[], int num, double pct) {
+  int rank = (int)(pct * num + 0.5);
+  return sorted[clamp(rank - 1, 0, num - 1)];
+}
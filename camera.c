@@ -0,0 +1,88 @@
+#include <math.h>
+
+#include "SDL.h"
+#include "red-planet.h"
+#include "camera.h"
+
+static bool find_focus(Pool* players, double alpha, float* x, float* y);
+static float follow(float pos, float focus, float view_size, float dead_zone);
+static float clamp_to_world(float pos, float view_size, float world_size);
+
+// the next update snaps straight to the players (e.g. at the start of a level)
+void camera_reset(Camera* camera) {
+  camera->is_placed = false;
+}
+
+void camera_update(Camera* camera, Viewport* viewport, Pool* players, double alpha, double dt) {
+  // the world shows under the header too
+  float view_w = viewport->w;
+  float view_h = viewport->h + header_height;
+
+  float focus_x, focus_y;
+  if (find_focus(players, alpha, &focus_x, &focus_y)) {
+    float target_x = follow(camera->x, focus_x, view_w, camera_dead_zone_w);
+    float target_y = follow(camera->y, focus_y, view_h, camera_dead_zone_h);
+
+    if (!camera->is_placed || camera_smoothing <= 0) {
+      camera->x = focus_x - view_w / 2;
+      camera->y = focus_y - view_h / 2;
+      camera->is_placed = true;
+    }
+    else {
+      // frame-rate independent: the same fraction of the gap closes per sec
+      float t = 1 - expf(-camera_smoothing * dt);
+      camera->x += (target_x - camera->x) * t;
+      camera->y += (target_y - camera->y) * t;
+    }
+  }
+
+  camera->x = clamp_to_world(camera->x, view_w, game_width);
+  camera->y = clamp_to_world(camera->y, view_h, game_height);
+
+  // whole px, so sprites & baked map chunks don't shimmer
+  viewport->x = (int)floorf(camera->x + 0.5f);
+  viewport->y = (int)floorf(camera->y + 0.5f);
+}
+
+// the middle of the box around every live player (as drawn this frame); false if there are none
+static bool find_focus(Pool* players, double alpha, float* x, float* y) {
+  float x1 = INFINITY, y1 = INFINITY, x2 = -INFINITY, y2 = -INFINITY;
+  for (int i = 0; i < players->count; ++i) {
+    if (players->flags[i] & DELETED)
+      continue;
+
+    float px = players->x[i];
+    float py = players->y[i];
+    if (!(players->flags[i] & SPAWNED)) {
+      px = players->prev_x[i] + (px - players->prev_x[i]) * alpha;
+      py = players->prev_y[i] + (py - players->prev_y[i]) * alpha;
+    }
+    x1 = fminf(x1, px);
+    y1 = fminf(y1, py);
+    x2 = fmaxf(x2, px + sprite_w);
+    y2 = fmaxf(y2, py + sprite_h);
+  }
+
+  if (x1 > x2)
+    return false;
+  *x = (x1 + x2) / 2;
+  *y = (y1 + y2) / 2;
+  return true;
+}
+
+// where the camera (along one axis) has to be for the focus to be inside the dead zone
+static float follow(float pos, float focus, float view_size, float dead_zone) {
+  float zone_min = pos + (view_size - dead_zone) / 2;
+  float zone_max = zone_min + dead_zone;
+  if (focus < zone_min)
+    return pos - (zone_min - focus);
+  if (focus > zone_max)
+    return pos + (focus - zone_max);
+  return pos;
+}
+
+static float clamp_to_world(float pos, float view_size, float world_size) {
+  if (world_size <= view_size)
+    return (world_size - view_size) / 2;
+  return fminf(fmaxf(pos, 0), world_size - view_size);
+}
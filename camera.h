@@ -0,0 +1,28 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <stdbool.h>
+
+#include "red-planet.h"
+
+// Camera that follows the players.
+//
+// The focus is the middle of the box around every live player. While it stays
+// inside the dead zone (a camera_dead_zone_w*h px box in the middle of the
+// view) the camera holds still; once it leaves, the camera heads for the
+// position that puts it back on the zone's edge, closing the gap exponentially
+// at camera_smoothing per sec (0 snaps). The result is clamped so the view
+// never leaves the world (a world smaller than the view is centered).
+//
+// camera_update() runs once a frame, with the same interpolated positions the
+// renderer uses, and writes the rounded result to the viewport's x/y.
+typedef struct {
+  float x;          // top-left of the view, world px
+  float y;
+  bool is_placed;   // false until the first update, which snaps to the focus
+} Camera;
+
+void camera_reset(Camera* camera);
+void camera_update(Camera* camera, Viewport* viewport, Pool* players, double alpha, double dt);
+
+#endif
@@ -0,0 +1,319 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "SDL.h"
+#include "red-planet.h"
+#include "assets.h"
+#include "json.h"
+#include "config.h"
+
+// how often the file's mtime is checked where inotify isn't available
+#define POLL_INTERVAL_MS 500
+
+typedef enum { CFG_INT, CFG_DOUBLE, CFG_COLOR, CFG_PATH } ConfigType;
+
+// when a changed value is applied: after a restart, right away, or (for what
+// the simulation reads) right away unless config_hold() is on, e.g. while
+// --record is logging, since the log has no record of mid-level changes
+typedef enum { RELOAD_RESTART, RELOAD_LIVE, RELOAD_SIM } ConfigReload;
+
+typedef struct {
+  char* key;
+  ConfigType type;
+  void* value;
+  double min;       // CFG_INT & CFG_DOUBLE values are clamped to [min, max]
+  double max;
+  ConfigReload reload;
+} ConfigField;
+
+typedef struct {
+  bool is_set;
+  int i;
+  double d;
+  SDL_Color color;
+  char path[MAX_ASSET_PATH];
+} ConfigValue;
+
+// sizes, capacities & tick_rate are read whenever a level starts, so they're
+// live too (they take effect from the next level)
+static ConfigField fields[] = {
+  {"start_screen",        CFG_PATH,   start_screen,         0, 0,       RELOAD_RESTART},
+  {"start_screen_bg",     CFG_COLOR,  &start_screen_bg,     0, 0,       RELOAD_LIVE},
+  {"spritesheet",         CFG_PATH,   spritesheet,          0, 0,       RELOAD_RESTART},
+  {"atlas",               CFG_PATH,   atlas_path,           0, 0,       RELOAD_RESTART},
+  {"game_width",          CFG_INT,    &game_width,          64, 16384,  RELOAD_RESTART},
+  {"game_height",         CFG_INT,    &game_height,         64, 16384,  RELOAD_RESTART},
+  {"header_height",       CFG_INT,    &header_height,       0, 200,     RELOAD_RESTART},
+  {"sprite_w",            CFG_INT,    &sprite_w,            1, 1024,    RELOAD_SIM},
+  {"sprite_h",            CFG_INT,    &sprite_h,            1, 1024,    RELOAD_SIM},
+  {"bullet_w",            CFG_INT,    &bullet_w,            1, 1024,    RELOAD_SIM},
+  {"bullet_h",            CFG_INT,    &bullet_h,            1, 1024,    RELOAD_SIM},
+  {"bullet_speed",        CFG_DOUBLE, &bullet_speed,        0, 100000,  RELOAD_SIM},
+  {"player_speed",        CFG_DOUBLE, &player_speed,        0, 100000,  RELOAD_SIM},
+  {"camera_dead_zone_w",  CFG_INT,    &camera_dead_zone_w,  0, 16384,   RELOAD_LIVE},
+  {"camera_dead_zone_h",  CFG_INT,    &camera_dead_zone_h,  0, 16384,   RELOAD_LIVE},
+  {"camera_smoothing",    CFG_DOUBLE, &camera_smoothing,    0, 1000,    RELOAD_LIVE},
+  {"max_players",         CFG_INT,    &max_players,         1, 4,       RELOAD_SIM},
+  {"max_enemies",         CFG_INT,    &max_enemies,         0, 1000000, RELOAD_SIM},
+  {"max_bullets",         CFG_INT,    &max_bullets,         0, 1000000, RELOAD_SIM},
+  {"max_collectables",    CFG_INT,    &max_collectables,    0, 1000000, RELOAD_SIM},
+  {"max_weapons",         CFG_INT,    &max_weapons,         0, 1000000, RELOAD_SIM},
+  {"max_particles",       CFG_INT,    &max_particles,       0, 1000000, RELOAD_LIVE},
+  {"tick_rate",           CFG_INT,    &tick_rate,           1, 1000,    RELOAD_SIM},
+  {"collision_cell_size", CFG_INT,    &collision_cell_size, 8, 4096,    RELOAD_SIM},
+  {"script",              CFG_PATH,   script_path,          0, 0,       RELOAD_SIM},
+  {"script_budget",       CFG_INT,    &script_budget,       0, 10000000, RELOAD_SIM},
+  {"audio_buffer",        CFG_INT,    &audio_buffer,        256, 8192,  RELOAD_RESTART}
+};
+
+#define NUM_FIELDS (int)(sizeof(fields) / sizeof(fields[0]))
+
+static char* watched_path = NULL;
+static ConfigValue values[NUM_FIELDS]; // as of the last successful read
+static ConfigValue held[NUM_FIELDS];   // RELOAD_SIM changes waiting for config_hold(false)
+static bool is_holding = false;
+static time_t config_mtime = 0;
+static Uint32 last_check = 0;
+#ifdef __linux__
+static int inotify_fd = -1;
+#endif
+
+static bool read_config(ConfigValue* out);
+static bool read_value(ConfigField* field, JsonReader* json, JsonToken token, ConfigValue* out);
+static void apply(ConfigField* field, ConfigValue* value);
+static bool has_changed();
+static time_t get_mtime(char* path);
+
+// reads the config (applying every value in it) & starts watching it;
+// false if it can't be read, in which case the defaults stay
+bool config_load(char* path) {
+  watched_path = path;
+  config_mtime = get_mtime(path);
+
+#ifdef __linux__
+  // editors often save by replacing the file, so the directory is watched
+  if (inotify_fd < 0) {
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    char dir[MAX_ASSET_PATH];
+    char* slash = strrchr(path, '/');
+    snprintf(dir, sizeof(dir), "%.*s", slash ? (int)(slash - path) : 1, slash ? path : ".");
+    if (inotify_fd >= 0 && inotify_add_watch(inotify_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+      close(inotify_fd);
+      inotify_fd = -1;
+    }
+  }
+#endif
+
+  ConfigValue read[NUM_FIELDS];
+  if (!read_config(read))
+    return false;
+
+  for (int f = 0; f < NUM_FIELDS; ++f)
+    if (read[f].is_set)
+      apply(&fields[f], &read[f]);
+  memcpy(values, read, sizeof(values));
+  return true;
+}
+
+// re-reads the config if it's changed; returns true if anything was applied
+bool config_poll() {
+  if (!watched_path || !has_changed())
+    return false;
+
+  // a file that's mid-save (or broken) is skipped; the next save triggers another read
+  ConfigValue read[NUM_FIELDS];
+  if (!read_config(read))
+    return false;
+
+  bool applied = false;
+  for (int f = 0; f < NUM_FIELDS; ++f) {
+    if (!read[f].is_set || (values[f].is_set && memcmp(&read[f], &values[f], sizeof(ConfigValue)) == 0))
+      continue;
+
+    if (fields[f].reload == RELOAD_RESTART)
+      printf("config: %s takes effect after a restart\n", fields[f].key);
+    else if (fields[f].reload == RELOAD_SIM && is_holding) {
+      held[f] = read[f];
+      printf("config: %s takes effect after recording\n", fields[f].key);
+    }
+    else {
+      apply(&fields[f], &read[f]);
+      printf("config: %s updated\n", fields[f].key);
+      applied = true;
+    }
+  }
+
+  memcpy(values, read, sizeof(values));
+  return applied;
+}
+
+// while on, changes to settings the simulation reads are kept back (& applied
+// when it's turned off)
+void config_hold(bool hold) {
+  is_holding = hold;
+  if (hold)
+    return;
+
+  for (int f = 0; f < NUM_FIELDS; ++f) {
+    if (!held[f].is_set)
+      continue;
+    apply(&fields[f], &held[f]);
+    printf("config: %s updated\n", fields[f].key);
+    held[f].is_set = false;
+  }
+}
+
+void config_quit() {
+#ifdef __linux__
+  if (inotify_fd >= 0)
+    close(inotify_fd);
+  inotify_fd = -1;
+#endif
+  watched_path = NULL;
+}
+
+static bool read_config(ConfigValue* out) {
+  memset(out, 0, NUM_FIELDS * sizeof(ConfigValue));
+
+  size_t len;
+  char* src = read_file(watched_path, &len);
+  if (!src)
+    return false;
+
+  JsonReader json;
+  json_init(&json, src, len);
+  JsonToken t = json_next(&json);
+  if (t == JSON_OBJECT) {
+    while ((t = json_next(&json)) == JSON_KEY) {
+      int f = 0;
+      while (f < NUM_FIELDS && strcmp(fields[f].key, json.str) != 0)
+        f++;
+      if (f == NUM_FIELDS)
+        printf("config: unknown key '%s'\n", json.str);
+
+      t = json_next(&json);
+      if (f < NUM_FIELDS && !read_value(&fields[f], &json, t, &out[f]))
+        printf("config: bad value for %s\n", fields[f].key);
+      if (json.err[0] || (f == NUM_FIELDS && !json_skip(&json, t)))
+        break;
+    }
+  }
+  free(src);
+
+  if (t != JSON_END_OBJECT) {
+    printf("config: %s isn't a valid JSON object (%s)\n", watched_path, json.err[0] ? json.err : "unexpected value");
+    return false;
+  }
+  return true;
+}
+
+// consumes the whole value (even a bad one); returns false if it doesn't fit the field
+static bool read_value(ConfigField* field, JsonReader* json, JsonToken token, ConfigValue* out) {
+  bool is_valid = true;
+  switch (field->type) {
+    case CFG_INT:
+      is_valid = token == JSON_NUMBER;
+      if (is_valid)
+        out->i = (int)fmin(fmax(json->num, field->min), field->max); // (clamped as a double, since a huge one won't fit an int)
+      break;
+    case CFG_DOUBLE:
+      is_valid = token == JSON_NUMBER;
+      if (is_valid)
+        out->d = fmin(fmax(json->num, field->min), field->max);
+      break;
+    case CFG_COLOR: {
+      // [r, g, b] or [r, g, b, a]
+      if (token != JSON_ARRAY) {
+        is_valid = false;
+        break;
+      }
+
+      Uint8 rgba[4] = {0, 0, 0, 255};
+      int n = 0;
+      int depth = json->depth;
+      while ((token = json_next(json)) == JSON_NUMBER)
+        if (n < 4)
+          rgba[n++] = (Uint8)fmin(fmax(json->num, 0), 255);
+
+      // anything but numbers: skip to the end of the array
+      while (token != JSON_END_ARRAY || json->depth >= depth) {
+        if (token == JSON_ERROR)
+          return false;
+        token = json_next(json);
+        n = 0;
+      }
+
+      if (n < 3)
+        return false;
+      out->color = (SDL_Color){rgba[0], rgba[1], rgba[2], rgba[3]};
+      break;
+    }
+    case CFG_PATH:
+      is_valid = token == JSON_STRING && strlen(json->str) < MAX_ASSET_PATH;
+      if (is_valid)
+        strcpy(out->path, json->str);
+      break;
+  }
+
+  if (!is_valid) {
+    json_skip(json, token);
+    return false;
+  }
+  out->is_set = true;
+  return true;
+}
+
+static void apply(ConfigField* field, ConfigValue* value) {
+  switch (field->type) {
+    case CFG_INT: *(int*)field->value = value->i; break;
+    case CFG_DOUBLE: *(double*)field->value = value->d; break;
+    case CFG_COLOR: *(SDL_Color*)field->value = value->color; break;
+    case CFG_PATH: strcpy(field->value, value->path); break;
+  }
+}
+
+static bool has_changed() {
+#ifdef __linux__
+  if (inotify_fd >= 0) {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    char* name = strrchr(watched_path, '/');
+    name = name ? name + 1 : watched_path;
+
+    bool changed = false;
+    ssize_t len;
+    while ((len = read(inotify_fd, buf, sizeof(buf))) > 0) {
+      for (char* p = buf; p < buf + len; p += sizeof(struct inotify_event) + ((struct inotify_event*)p)->len) {
+        struct inotify_event* event = (struct inotify_event*)p;
+        if (event->len && strcmp(event->name, name) == 0)
+          changed = true;
+      }
+    }
+    return changed;
+  }
+#endif
+
+  Uint32 now = SDL_GetTicks();
+  if (now - last_check < POLL_INTERVAL_MS)
+    return false;
+  last_check = now;
+
+  time_t mtime = get_mtime(watched_path);
+  if (mtime == config_mtime)
+    return false;
+  config_mtime = mtime;
+  return true;
+}
+
+static time_t get_mtime(char* path) {
+  struct stat st;
+  return stat(path, &st) == 0 ? st.st_mtime : 0;
+}
@@ -0,0 +1,24 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdbool.h>
+
+// Game config (example/config.json).
+//
+// Each key is bound to one of the game's tunable globals with a type, so the
+// file is read in a single streaming pass straight into them, with no tree
+// and no lookups afterwards. Missing keys keep their defaults.
+//
+// The file is watched (inotify on Linux, mtime polling elsewhere) and
+// config_poll(), called between frames, re-reads it when it changes and
+// applies the values that differ from the last read. A few settings are
+// only read at startup; changing those just prints a note. config_hold()
+// keeps back changes to the settings the simulation reads (while a session
+// is being recorded).
+
+bool config_load(char* path);
+bool config_poll();
+void config_hold(bool hold);
+void config_quit();
+
+#endif
@@ -0,0 +1,66 @@
+-- Example enemy script: set "script": "example/enemies.lua" in the config
+-- (and build with `make SCRIPTING=1`). See script.h & the README.
+
+-- one enemy that drifts toward the nearest player
+local function chaser(id, speed)
+  local me, players = {id}, {}
+  while true do
+    local dt = coroutine.yield()
+    local x, y = rp.get("enemies", "x", me)[1], rp.get("enemies", "y", me)[1]
+    local ids, n = rp.ids("players", players)
+    if n > 0 then
+      local px, py = rp.get("players", "x", ids), rp.get("players", "y", ids)
+      local best, tx, ty = math.huge, x, y
+      for k = 1, n do
+        local d = (px[k] - x) ^ 2 + (py[k] - y) ^ 2
+        if d < best then best, tx, ty = d, px[k], py[k] end
+      end
+      local len = math.sqrt(best)
+      if len > 1 then
+        rp.set("enemies", "x", me, {x + (tx - x) / len * speed * dt})
+        rp.set("enemies", "y", me, {y + (ty - y) / len * speed * dt})
+      end
+    end
+  end
+end
+
+-- a whole row of enemies sweeping back & forth together, moved with one
+-- get/set per field per tick however many there are; done once they're all dead
+local function squad(ids, speed)
+  local xs, dir = {}, 1
+  while true do
+    local dt = coroutine.yield()
+    rp.get("enemies", "x", ids, xs)
+    local turn, alive = false, false
+    for k = 1, #ids do
+      if xs[k] then
+        alive = true
+        xs[k] = xs[k] + dir * speed * dt
+        if xs[k] < 0 or xs[k] > rp.game_width - rp.sprite_w then turn = true end
+      end
+    end
+    if not alive then return end
+    rp.set("enemies", "x", ids, xs)
+    if turn then dir = -dir end
+  end
+end
+
+-- a wave every few seconds
+rp.run(function()
+  local wave = 0
+  while true do
+    wave = wave + 1
+    local row = {}
+    for k = 1, 8 + wave do
+      row[#row + 1] = rp.spawn((k - 1) * (rp.sprite_w + 8), 40 + (wave % 4) * 60)
+    end
+    rp.run(squad, row, 80 + wave * 10)
+
+    for k = 1, wave do
+      rp.spawn(rp.rand() * (rp.game_width - rp.sprite_w), rp.game_height - rp.sprite_h, chaser, 60)
+    end
+
+    local t = 0
+    while t < 8 do t = t + coroutine.yield() end
+  end
+end)
@@ -0,0 +1,184 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "red-planet.h"
+#include "jobs.h"
+
+typedef struct {
+  JobFn fn;
+  void* data;
+  int begin;
+  int end;
+  JobCounter* counter;
+} Job;
+
+// Chase-Lev deque: the owner pushes & pops at the bottom, thieves take from
+// the top; only taking the last job needs a CAS against thieves
+typedef struct {
+  Job jobs[JOB_QUEUE_SIZE];
+  SDL_atomic_t top;
+  SDL_atomic_t bottom;
+} JobQueue;
+
+// queue 0 belongs to the thread that called jobs_init() (the game loop)
+static JobQueue queues[MAX_JOB_THREADS + 1];
+static SDL_Thread* threads[MAX_JOB_THREADS];
+static int num_threads = 0;
+static SDL_sem* wake = NULL;
+static SDL_atomic_t quit = {};
+static _Thread_local int thread_index = 0;
+
+static int worker(void* data);
+static bool push(JobQueue* queue, Job* job);
+static bool pop(JobQueue* queue, Job* job);
+static bool steal(JobQueue* queue, Job* job);
+static bool find_job(Job* job);
+static void run_job(Job* job);
+
+// -1 threads = one per core besides the caller's
+void jobs_init(int num) {
+  if (num < 0)
+    num = SDL_GetCPUCount() - 1;
+  num_threads = clamp(num, 0, MAX_JOB_THREADS);
+  if (!num_threads)
+    return;
+
+  wake = SDL_CreateSemaphore(0);
+  if (!wake)
+    error("creating job semaphore");
+
+  for (int i = 0; i < num_threads; ++i) {
+    threads[i] = SDL_CreateThread(worker, "jobs", (void*)(intptr_t)(i + 1));
+    if (!threads[i])
+      error("creating job thread");
+  }
+}
+
+// queues fn over [0, count) in chunks of chunk_size, once `after` (if any) is done
+void jobs_run(JobCounter* counter, JobCounter* after, JobFn fn, void* data, int count, int chunk_size) {
+  if (after)
+    jobs_wait(after);
+
+  int num_chunks = (count + chunk_size - 1) / chunk_size;
+  SDL_AtomicAdd(&counter->pending, num_chunks);
+  if (!num_threads || num_chunks == 1) {
+    for (int begin = 0; begin < count; begin += chunk_size) {
+      fn(data, begin, begin + chunk_size < count ? begin + chunk_size : count);
+      SDL_AtomicAdd(&counter->pending, -1);
+    }
+    return;
+  }
+
+  // one wakeup per queued job, so a sleeping worker can't miss one
+  JobQueue* queue = &queues[thread_index];
+  for (int begin = 0; begin < count; begin += chunk_size) {
+    Job job = {.fn = fn, .data = data, .begin = begin, .end = begin + chunk_size < count ? begin + chunk_size : count, .counter = counter};
+    if (push(queue, &job))
+      SDL_SemPost(wake);
+    else
+      run_job(&job); // full: do it now
+  }
+}
+
+// helps with any queued jobs until the counter's jobs are all done
+void jobs_wait(JobCounter* counter) {
+  Job job;
+  while (SDL_AtomicGet(&counter->pending) > 0) {
+    if (find_job(&job))
+      run_job(&job);
+  }
+}
+
+int jobs_num_threads() {
+  return num_threads;
+}
+
+void jobs_quit() {
+  SDL_AtomicSet(&quit, 1);
+  for (int i = 0; i < num_threads; ++i)
+    SDL_SemPost(wake);
+  for (int i = 0; i < num_threads; ++i)
+    SDL_WaitThread(threads[i], NULL);
+  num_threads = 0;
+
+  if (wake)
+    SDL_DestroySemaphore(wake);
+  wake = NULL;
+  SDL_AtomicSet(&quit, 0);
+}
+
+static int worker(void* data) {
+  thread_index = (intptr_t)data;
+
+  // there's a wakeup per queued job; a worker that wakes up takes whatever's
+  // queued & then sleeps again, so idle workers never spin (once other threads
+  // have taken the jobs, their leftover wakeups just find nothing)
+  Job job;
+  while (SDL_SemWait(wake) == 0 && !SDL_AtomicGet(&quit)) {
+    while (find_job(&job))
+      run_job(&job);
+  }
+  return 0;
+}
+
+static bool push(JobQueue* queue, Job* job) {
+  int bottom = SDL_AtomicGet(&queue->bottom);
+  if (bottom - SDL_AtomicGet(&queue->top) >= JOB_QUEUE_SIZE)
+    return false;
+
+  queue->jobs[bottom & (JOB_QUEUE_SIZE - 1)] = *job;
+  SDL_MemoryBarrierRelease();
+  SDL_AtomicSet(&queue->bottom, bottom + 1);
+  return true;
+}
+
+static bool pop(JobQueue* queue, Job* job) {
+  int bottom = SDL_AtomicGet(&queue->bottom) - 1;
+  SDL_AtomicSet(&queue->bottom, bottom); // (a full barrier) before reading top
+  int top = SDL_AtomicGet(&queue->top);
+  if (top > bottom) {
+    SDL_AtomicSet(&queue->bottom, bottom + 1);
+    return false;
+  }
+
+  *job = queue->jobs[bottom & (JOB_QUEUE_SIZE - 1)];
+  if (top < bottom)
+    return true;
+
+  // the last job: whoever moves top first gets it
+  bool won = SDL_AtomicCAS(&queue->top, top, top + 1);
+  SDL_AtomicSet(&queue->bottom, bottom + 1);
+  return won;
+}
+
+static bool steal(JobQueue* queue, Job* job) {
+  int top = SDL_AtomicGet(&queue->top);
+  int bottom = SDL_AtomicGet(&queue->bottom);
+  if (top >= bottom)
+    return false;
+
+  Job stolen = queue->jobs[top & (JOB_QUEUE_SIZE - 1)];
+  if (!SDL_AtomicCAS(&queue->top, top, top + 1))
+    return false;
+
+  *job = stolen;
+  return true;
+}
+
+// own queue first, then the others, starting with the next thread's
+static bool find_job(Job* job) {
+  if (pop(&queues[thread_index], job))
+    return true;
+
+  for (int i = 1; i <= num_threads; ++i)
+    if (steal(&queues[(thread_index + i) % (num_threads + 1)], job))
+      return true;
+  return false;
+}
+
+static void run_job(Job* job) {
+  job->fn(job->data, job->begin, job->end);
+  SDL_MemoryBarrierRelease();
+  SDL_AtomicAdd(&job->counter->pending, -1);
+}
@@ -0,0 +1,32 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "SDL.h"
+
+// Work-stealing job system.
+//
+// jobs_run() splits a range of items into chunks and pushes them onto the
+// calling thread's deque; every thread (the caller included, while it waits)
+// pops from the bottom of its own deque and, when that's empty, steals from
+// the top of another's. A JobCounter counts a phase's unfinished chunks;
+// waiting on it means the phase is done, and passing it as `after` to the next
+// jobs_run() makes that phase depend on it.
+//
+// With no worker threads (or a single chunk) jobs just run inline.
+
+#define MAX_JOB_THREADS 16
+#define JOB_QUEUE_SIZE 1024 // per thread; must be a power of 2
+
+typedef void (*JobFn)(void* data, int begin, int end);
+
+typedef struct {
+  SDL_atomic_t pending;
+} JobCounter;
+
+void jobs_init(int num_threads);
+void jobs_run(JobCounter* counter, JobCounter* after, JobFn fn, void* data, int count, int chunk_size);
+void jobs_wait(JobCounter* counter);
+int jobs_num_threads();
+void jobs_quit();
+
+#endif
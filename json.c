@@ -0,0 +1,203 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "json.h"
+
+static JsonToken fail(JsonReader* json, char* msg);
+static JsonToken read_string(JsonReader* json);
+static JsonToken read_number(JsonReader* json);
+static JsonToken read_literal(JsonReader* json, char* word, JsonToken token);
+static void append_utf8(JsonReader* json, int* len, unsigned int code);
+
+void json_init(JsonReader* json, const char* src, size_t len) {
+  memset(json, 0, sizeof(JsonReader));
+  json->src = src;
+  json->len = len;
+}
+
+JsonToken json_next(JsonReader* json) {
+  // separators carry no information for a pull reader, so they're skipped
+  // (this makes the reader lenient about commas, not strict)
+  while (json->pos < json->len) {
+    char c = json->src[json->pos];
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == ':')
+      json->pos++;
+    else if (c == ',') {
+      json->pos++;
+      if (json->depth && json->in_object[json->depth - 1])
+        json->expect_key = true;
+    }
+    else
+      break;
+  }
+
+  if (json->pos >= json->len)
+    return json->depth ? fail(json, "unexpected end of input") : JSON_EOF;
+
+  char c = json->src[json->pos];
+  switch (c) {
+    case '{':
+    case '[':
+      if (json->depth == JSON_MAX_DEPTH)
+        return fail(json, "nested too deeply");
+      json->pos++;
+      json->in_object[json->depth++] = c == '{';
+      json->expect_key = c == '{';
+      return c == '{' ? JSON_OBJECT : JSON_ARRAY;
+    case '}':
+    case ']':
+      if (!json->depth || json->in_object[json->depth - 1] != (c == '}'))
+        return fail(json, "mismatched bracket");
+      json->pos++;
+      json->depth--;
+      json->expect_key = false;
+      return c == '}' ? JSON_END_OBJECT : JSON_END_ARRAY;
+    case '"': {
+      bool is_key = json->expect_key;
+      json->expect_key = false;
+      JsonToken token = read_string(json);
+      return token == JSON_STRING && is_key ? JSON_KEY : token;
+    }
+    case 't':
+      return read_literal(json, "true", JSON_TRUE);
+    case 'f':
+      return read_literal(json, "false", JSON_FALSE);
+    case 'n':
+      return read_literal(json, "null", JSON_NULL);
+    default:
+      return read_number(json);
+  }
+}
+
+// skips the rest of the value that `token` started (a no-op for scalars)
+// returns false on a parse error
+bool json_skip(JsonReader* json, JsonToken token) {
+  if (token == JSON_ERROR || token == JSON_EOF)
+    return false;
+  if (token != JSON_OBJECT && token != JSON_ARRAY)
+    return true;
+
+  int depth = json->depth - 1;
+  while (json->depth > depth) {
+    JsonToken t = json_next(json);
+    if (t == JSON_ERROR || t == JSON_EOF)
+      return false;
+  }
+  return true;
+}
+
+// reads a whole file into a NUL-terminated buffer (caller frees); NULL on failure
+char* read_file(char* path, size_t* len) {
+  FILE* file = fopen(path, "rb");
+  if (!file)
+    return NULL;
+
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  char* buf = size >= 0 ? malloc(size + 1) : NULL;
+  if (!buf || fread(buf, 1, size, file) != (size_t)size) {
+    free(buf);
+    fclose(file);
+    return NULL;
+  }
+  fclose(file);
+
+  buf[size] = '\0';
+  if (len)
+    *len = size;
+  return buf;
+}
+
+static JsonToken fail(JsonReader* json, char* msg) {
+  snprintf(json->err, sizeof(json->err), "%s at byte %zu", msg, json->pos);
+  json->pos = json->len;
+  json->depth = 0;
+  return JSON_ERROR;
+}
+
+static JsonToken read_string(JsonReader* json) {
+  int len = 0;
+  json->pos++; // opening quote
+  while (json->pos < json->len) {
+    char c = json->src[json->pos++];
+    if (c == '"') {
+      json->str[len] = '\0';
+      return JSON_STRING;
+    }
+
+    if (c == '\\') {
+      if (json->pos >= json->len)
+        break;
+      c = json->src[json->pos++];
+      switch (c) {
+        case 'n': c = '\n'; break;
+        case 't': c = '\t'; break;
+        case 'r': c = '\r'; break;
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'u': {
+          if (json->pos + 4 > json->len)
+            return fail(json, "bad \\u escape");
+          char hex[5] = {};
+          memcpy(hex, json->src + json->pos, 4);
+          json->pos += 4;
+          append_utf8(json, &len, strtoul(hex, NULL, 16));
+          continue;
+        }
+        // '"', '\\' & '/' stand for themselves
+      }
+    }
+
+    if (len < JSON_MAX_STR - 1)
+      json->str[len++] = c;
+  }
+  return fail(json, "unterminated string");
+}
+
+static JsonToken read_number(JsonReader* json) {
+  const char* start = json->src + json->pos;
+  char* end;
+  json->num = strtod(start, &end);
+  if (end == start)
+    return fail(json, "unexpected character");
+
+  json->pos += end - start;
+  return JSON_NUMBER;
+}
+
+static JsonToken read_literal(JsonReader* json, char* word, JsonToken token) {
+  size_t len = strlen(word);
+  if (json->pos + len > json->len || strncmp(json->src + json->pos, word, len) != 0)
+    return fail(json, "unexpected character");
+
+  json->pos += len;
+  return token;
+}
+
+static void append_utf8(JsonReader* json, int* len, unsigned int code) {
+  char buf[3];
+  int num;
+  if (code < 0x80) {
+    buf[0] = code;
+    num = 1;
+  }
+  else if (code < 0x800) {
+    buf[0] = 0xC0 | (code >> 6);
+    buf[1] = 0x80 | (code & 0x3F);
+    num = 2;
+  }
+  else {
+    buf[0] = 0xE0 | (code >> 12);
+    buf[1] = 0x80 | ((code >> 6) & 0x3F);
+    buf[2] = 0x80 | (code & 0x3F);
+    num = 3;
+  }
+
+  if (*len + num < JSON_MAX_STR) {
+    memcpy(json->str + *len, buf, num);
+    *len += num;
+  }
+}
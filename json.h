@@ -0,0 +1,48 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Streaming (pull) JSON reader.
+//
+// json_next() returns one token at a time straight out of the source buffer;
+// nothing is allocated and no tree is built, so arbitrarily large documents
+// (e.g. maps with hundreds of thousands of tiles) are read in one pass with
+// constant memory. Object keys come back as JSON_KEY, followed by their value.
+typedef enum {
+  JSON_EOF,
+  JSON_ERROR,
+  JSON_OBJECT,      // {
+  JSON_END_OBJECT,  // }
+  JSON_ARRAY,       // [
+  JSON_END_ARRAY,   // ]
+  JSON_KEY,
+  JSON_STRING,
+  JSON_NUMBER,
+  JSON_TRUE,
+  JSON_FALSE,
+  JSON_NULL
+} JsonToken;
+
+#define JSON_MAX_DEPTH 64
+#define JSON_MAX_STR 256
+
+typedef struct {
+  const char* src;
+  size_t len;
+  size_t pos;
+  int depth;
+  bool in_object[JSON_MAX_DEPTH];
+  bool expect_key;
+  char str[JSON_MAX_STR]; // value of the last JSON_KEY/JSON_STRING (truncated to fit)
+  double num;             // value of the last JSON_NUMBER
+  char err[64];
+} JsonReader;
+
+void json_init(JsonReader* json, const char* src, size_t len);
+JsonToken json_next(JsonReader* json);
+bool json_skip(JsonReader* json, JsonToken token);
+char* read_file(char* path, size_t* len);
+
+#endif
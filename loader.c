@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "SDL_image.h"
+#include "SDL_mixer.h"
+#include "red-planet.h"
+#include "assets.h"
+#include "loader.h"
+
+typedef enum { JOB_IMAGE, JOB_SOUND, JOB_TASK } JobType;
+
+typedef struct {
+  JobType type;
+  char path[MAX_ASSET_PATH];
+  SDL_Texture** tex;
+  Mix_Chunk** chunk;
+  bool (*work)(void* data);
+  void (*finish)(void* data);
+  void* data;
+
+  // written by the worker, read on the render thread once is_done is set
+  SDL_Surface* surface;
+  Mix_Chunk* loaded_chunk;
+  char err[128];
+  SDL_atomic_t is_done;
+
+  bool is_finished; // handed over on the render thread
+} LoadJob;
+
+// jobs are only added on the render thread; a worker claims the next queued
+// one by bumping next_queued after each semaphore post
+static LoadJob jobs[MAX_LOAD_JOBS];
+static int num_jobs = 0;
+static int num_finished = 0;
+static int queue[MAX_LOAD_JOBS];
+static int num_queued = 0;
+static SDL_atomic_t next_queued = {};
+static SDL_sem* job_sem = NULL;
+static SDL_Thread* threads[MAX_LOADER_THREADS];
+static int num_threads = 0;
+static SDL_atomic_t quit = {};
+
+static LoadJob* add_job(JobType type, char* path);
+static void submit(LoadJob* job);
+static int worker(void* unused);
+static void finish_job(SDL_Renderer* renderer, LoadJob* job);
+
+void loader_init() {
+  job_sem = SDL_CreateSemaphore(0);
+  if (!job_sem)
+    error("creating loader semaphore");
+
+  // leave a core for the render thread
+  num_threads = clamp(SDL_GetCPUCount() - 1, 1, MAX_LOADER_THREADS);
+  for (int i = 0; i < num_threads; ++i) {
+    threads[i] = SDL_CreateThread(worker, "loader", NULL);
+    if (!threads[i])
+      error("creating loader thread");
+  }
+}
+
+void load_image_async(SDL_Texture** tex, char* path) {
+  LoadJob* job = add_job(JOB_IMAGE, path);
+  job->tex = tex;
+
+  // packed images are uploaded straight from the pack, so there's nothing to decode
+  if (pack_has(path))
+    SDL_AtomicSet(&job->is_done, 1);
+  else
+    submit(job);
+}
+
+void load_sound_async(Mix_Chunk** chunk, char* path) {
+  LoadJob* job = add_job(JOB_SOUND, path);
+  job->chunk = chunk;
+  submit(job);
+}
+
+void load_task_async(bool (*work)(void* data), void (*finish)(void* data), void* data) {
+  LoadJob* job = add_job(JOB_TASK, "");
+  job->work = work;
+  job->finish = finish;
+  job->data = data;
+  submit(job);
+}
+
+// hands over every job that's done; returns true once nothing is left
+bool loader_poll(SDL_Renderer* renderer) {
+  // finishing a job (a task) can add more, so num_jobs is re-read each time
+  for (int j = 0; j < num_jobs; ++j) {
+    LoadJob* job = &jobs[j];
+    if (job->is_finished || !SDL_AtomicGet(&job->is_done))
+      continue;
+
+    SDL_MemoryBarrierAcquire();
+    finish_job(renderer, job);
+    job->is_finished = true;
+    num_finished++;
+  }
+
+  if (num_finished < num_jobs)
+    return false;
+
+  // every queued job has been claimed & finished, so the slots can be reused
+  num_jobs = num_finished = num_queued = 0;
+  SDL_AtomicSet(&next_queued, 0);
+  return true;
+}
+
+// fraction of the jobs added since the loader was last idle that are finished
+float loader_progress() {
+  return num_jobs ? (float)num_finished / num_jobs : 1;
+}
+
+void loader_quit() {
+  SDL_AtomicSet(&quit, 1);
+  for (int i = 0; i < num_threads; ++i)
+    SDL_SemPost(job_sem);
+  for (int i = 0; i < num_threads; ++i)
+    SDL_WaitThread(threads[i], NULL);
+  num_threads = 0;
+
+  // results nobody picked up
+  for (int j = 0; j < num_jobs; ++j) {
+    if (jobs[j].is_finished || !SDL_AtomicGet(&jobs[j].is_done))
+      continue;
+    if (jobs[j].surface)
+      SDL_FreeSurface(jobs[j].surface);
+    if (jobs[j].loaded_chunk)
+      Mix_FreeChunk(jobs[j].loaded_chunk);
+  }
+  num_jobs = num_finished = num_queued = 0;
+
+  SDL_DestroySemaphore(job_sem);
+  job_sem = NULL;
+}
+
+static LoadJob* add_job(JobType type, char* path) {
+  if (num_jobs == MAX_LOAD_JOBS) {
+    SDL_SetError("more than %d assets queued", MAX_LOAD_JOBS);
+    error("queueing asset");
+  }
+  if (strlen(path) >= MAX_ASSET_PATH) {
+    SDL_SetError("asset path too long: %s", path);
+    error("queueing asset");
+  }
+
+  LoadJob* job = &jobs[num_jobs++];
+  memset(job, 0, sizeof(LoadJob));
+  job->type = type;
+  strcpy(job->path, path);
+  return job;
+}
+
+static void submit(LoadJob* job) {
+  queue[num_queued++] = job - jobs;
+  SDL_SemPost(job_sem);
+}
+
+static int worker(void* unused) {
+  while (SDL_SemWait(job_sem) == 0 && !SDL_AtomicGet(&quit)) {
+    LoadJob* job = &jobs[queue[SDL_AtomicAdd(&next_queued, 1)]];
+
+    if (job->type == JOB_IMAGE)
+      job->surface = IMG_Load(job->path);
+    else if (job->type == JOB_SOUND)
+      job->loaded_chunk = Mix_LoadWAV(job->path);
+    else if (!job->work(job->data))
+      snprintf(job->err, sizeof(job->err), "%s", SDL_GetError());
+
+    // SDL's error string is per thread, so it's copied for the render thread
+    if ((job->type == JOB_IMAGE && !job->surface) || (job->type == JOB_SOUND && !job->loaded_chunk))
+      snprintf(job->err, sizeof(job->err), "%s: %s", job->path, SDL_GetError());
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&job->is_done, 1);
+  }
+  return 0;
+}
+
+static void finish_job(SDL_Renderer* renderer, LoadJob* job) {
+  // the game can run without a sound, but not without an image
+  if (job->err[0] && job->type == JOB_SOUND) {
+    printf("Not using sound %s\n", job->err);
+    return;
+  }
+  if (job->err[0]) {
+    SDL_SetError("%s", job->err);
+    error(job->type == JOB_TASK ? "loading level data" : "loading image");
+  }
+
+  if (job->type == JOB_IMAGE) {
+    SDL_Texture* tex = job->surface ? cache_surface(renderer, job->path, job->surface) : load_texture(renderer, job->path);
+    if (job->surface)
+      SDL_FreeSurface(job->surface);
+    if (!tex)
+      error("creating texture");
+    if (job->tex)
+      *job->tex = tex;
+  }
+  else if (job->type == JOB_SOUND) {
+    *job->chunk = job->loaded_chunk;
+  }
+  else if (job->finish) {
+    job->finish(job->data);
+  }
+}
@@ -0,0 +1,34 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <stdbool.h>
+
+#include "SDL.h"
+#include "SDL_mixer.h"
+
+// Asynchronous asset loading.
+//
+// Images are decoded (and WAVs loaded) on worker threads; the render thread
+// picks up finished jobs in loader_poll() and does the part that has to happen
+// there, i.e. creating textures from the decoded surfaces. Images that are in
+// the asset pack don't need decoding, so they skip the workers entirely.
+//
+// Results are written through the out pointers passed in (which may be NULL
+// to just warm the texture cache), on the render thread, during loader_poll().
+// Tasks run `work` on a worker & then `finish` on the render thread; `work`
+// returns false (with SDL_GetError() set) if it fails, since only the render
+// thread reports errors. A sound that fails to load just prints a warning (its
+// chunk stays NULL); anything else that fails is fatal.
+
+#define MAX_LOAD_JOBS 64
+#define MAX_LOADER_THREADS 4
+
+void loader_init();
+void load_image_async(SDL_Texture** tex, char* path);
+void load_sound_async(Mix_Chunk** chunk, char* path);
+void load_task_async(bool (*work)(void* data), void (*finish)(void* data), void* data);
+bool loader_poll(SDL_Renderer* renderer);
+float loader_progress();
+void loader_quit();
+
+#endif
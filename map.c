@@ -0,0 +1,758 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "json.h"
+#include "map.h"
+
+typedef struct {
+  const char* name;
+  int name_len;
+  const char* attrs;
+  const char* attrs_end;
+  bool is_closing;
+  bool is_self_closing;
+} XmlTag;
+
+static bool load_json_map(Map* map, char* src, size_t len, char* dir);
+static bool read_json_layers(Map* map, JsonReader* json);
+static bool read_json_tileset(Tileset* tileset, JsonReader* json, char* dir);
+static bool load_tmx_map(Map* map, char* src, size_t len, char* dir);
+static bool load_external_tileset(Tileset* tileset, char* path);
+static bool json_fail(JsonReader* json);
+static bool next_tag(const char** pos, const char* end, XmlTag* tag);
+static bool tag_is(XmlTag* tag, char* name);
+static bool tag_attr(XmlTag* tag, char* name, char* out, int out_len);
+static int tag_int(XmlTag* tag, char* name, int def);
+static TileLayer* add_layer(Map* map);
+static Tileset* add_tileset(Map* map);
+static bool push_gid(Uint32** gids, int* num, int* cap, Uint32 gid);
+static bool check_layer(TileLayer* layer, int num_gids);
+static void dir_of(char* path, char* dir);
+static void join_path(char* dir, char* file, char* out);
+static bool ends_with(char* str, char* suffix);
+static int floor_div(int a, int b);
+static Tileset* tileset_for(Map* map, Uint32 gid);
+static void bake_chunk(Map* map, TileLayer* layer, int cx, int cy, SDL_Renderer* renderer);
+
+// parses the map & splits its layers into chunks; textures are loaded separately.
+// Runs on a loader thread, so it doesn't call error(): false with
+// SDL_GetError() set if the map can't be read or doesn't make sense
+bool map_load(Map* map, char* path) {
+  memset(map, 0, sizeof(Map));
+
+  size_t len;
+  char* src = read_file(path, &len);
+  if (!src) {
+    SDL_SetError("can't read %s", path);
+    return false;
+  }
+
+  char dir[MAX_MAP_PATH];
+  dir_of(path, dir);
+  bool loaded = ends_with(path, ".tmx") ? load_tmx_map(map, src, len, dir) : load_json_map(map, src, len, dir);
+  free(src);
+  if (!loaded)
+    return false;
+
+  if (map->w <= 0 || map->h <= 0 || map->tile_w <= 0 || map->tile_h <= 0) {
+    SDL_SetError("%s has no size or tile size", path);
+    return false;
+  }
+
+  // (every layer got its w*h tiles when it was read; this catches any that had none)
+  for (int l = 0; l < map->num_layers; ++l) {
+    if (!map->layers[l].gids) {
+      SDL_SetError("layer '%s' has no tile data", map->layers[l].name);
+      return false;
+    }
+  }
+
+  for (int t = 0; t < map->num_tilesets; ++t) {
+    Tileset* tileset = &map->tilesets[t];
+    if (!tileset->columns && tileset->tile_w > 0)
+      tileset->columns = (tileset->img_w - 2 * tileset->margin + tileset->spacing) / (tileset->tile_w + tileset->spacing);
+  }
+
+  for (int l = 0; l < map->num_layers; ++l) {
+    TileLayer* layer = &map->layers[l];
+    layer->chunks_w = (layer->w + CHUNK_TILES - 1) / CHUNK_TILES;
+    layer->chunks_h = (layer->h + CHUNK_TILES - 1) / CHUNK_TILES;
+    layer->chunks = calloc(layer->chunks_w * layer->chunks_h + 1, sizeof(Chunk));
+    if (!layer->chunks) {
+      SDL_SetError("out of memory for map chunks");
+      return false;
+    }
+  }
+  return true;
+}
+
+// draws every visible layer's chunks that intersect the viewport, baking any
+// that haven't been yet
+void map_render(Map* map, SDL_Renderer* renderer, Viewport* viewport) {
+  // (no map: its tile size is 0)
+  if (!map->num_layers)
+    return;
+
+  int chunk_px_w = CHUNK_TILES * map->tile_w;
+  int chunk_px_h = CHUNK_TILES * map->tile_h;
+
+  // the world is drawn under the header too, so the visible area is the whole window
+  int view_h = viewport->h + header_height;
+  int cx1 = floor_div(viewport->x, chunk_px_w);
+  int cy1 = floor_div(viewport->y, chunk_px_h);
+  int cx2 = floor_div(viewport->x + viewport->w - 1, chunk_px_w);
+  int cy2 = floor_div(viewport->y + view_h - 1, chunk_px_h);
+
+  for (int l = 0; l < map->num_layers; ++l) {
+    TileLayer* layer = &map->layers[l];
+    if (!layer->visible)
+      continue;
+
+    for (int cy = clamp(cy1, 0, layer->chunks_h); cy <= cy2 && cy < layer->chunks_h; ++cy) {
+      for (int cx = clamp(cx1, 0, layer->chunks_w); cx <= cx2 && cx < layer->chunks_w; ++cx) {
+        Chunk* chunk = &layer->chunks[cy * layer->chunks_w + cx];
+        if (chunk->state == CHUNK_UNBAKED)
+          bake_chunk(map, layer, cx, cy, renderer);
+        if (chunk->state != CHUNK_BAKED)
+          continue;
+
+        int tiles_w = clamp(layer->w - cx * CHUNK_TILES, 0, CHUNK_TILES);
+        int tiles_h = clamp(layer->h - cy * CHUNK_TILES, 0, CHUNK_TILES);
+        SDL_Rect dest = {
+          .x = cx * chunk_px_w - viewport->x,
+          .y = cy * chunk_px_h - viewport->y,
+          .w = tiles_w * map->tile_w,
+          .h = tiles_h * map->tile_h
+        };
+        if (SDL_RenderCopy(renderer, chunk->tex, NULL, &dest) < 0)
+          error("rendering map chunk");
+      }
+    }
+  }
+}
+
+// marks every chunk for re-baking (render target contents are lost when the
+// renderer's device is reset); the textures themselves are reused
+void map_invalidate(Map* map) {
+  for (int l = 0; l < map->num_layers; ++l) {
+    TileLayer* layer = &map->layers[l];
+    for (int c = 0; c < layer->chunks_w * layer->chunks_h; ++c)
+      if (layer->chunks[c].state == CHUNK_BAKED)
+        layer->chunks[c].state = CHUNK_UNBAKED;
+  }
+}
+
+void map_free(Map* map) {
+  for (int l = 0; l < map->num_layers; ++l) {
+    TileLayer* layer = &map->layers[l];
+    for (int c = 0; c < layer->chunks_w * layer->chunks_h; ++c)
+      if (layer->chunks[c].tex)
+        SDL_DestroyTexture(layer->chunks[c].tex);
+    free(layer->chunks);
+    free(layer->gids);
+  }
+  free(map->layers);
+
+  memset(map, 0, sizeof(Map));
+}
+
+// Tiled JSON (.json/.tmj)
+
+static bool load_json_map(Map* map, char* src, size_t len, char* dir) {
+  JsonReader json;
+  json_init(&json, src, len);
+  if (json_next(&json) != JSON_OBJECT)
+    return json_fail(&json);
+
+  JsonToken t;
+  while ((t = json_next(&json)) == JSON_KEY) {
+    char key[JSON_MAX_STR];
+    strcpy(key, json.str);
+    t = json_next(&json);
+
+    if (strcmp(key, "width") == 0 && t == JSON_NUMBER)
+      map->w = json.num;
+    else if (strcmp(key, "height") == 0 && t == JSON_NUMBER)
+      map->h = json.num;
+    else if (strcmp(key, "tilewidth") == 0 && t == JSON_NUMBER)
+      map->tile_w = json.num;
+    else if (strcmp(key, "tileheight") == 0 && t == JSON_NUMBER)
+      map->tile_h = json.num;
+    else if (strcmp(key, "infinite") == 0 && t == JSON_TRUE) {
+      SDL_SetError("infinite maps aren't supported");
+      return false;
+    }
+    else if (strcmp(key, "orientation") == 0 && t == JSON_STRING && strcmp(json.str, "orthogonal") != 0) {
+      SDL_SetError("only orthogonal maps are supported");
+      return false;
+    }
+    else if (strcmp(key, "layers") == 0 && t == JSON_ARRAY) {
+      if (!read_json_layers(map, &json))
+        return false;
+    }
+    else if (strcmp(key, "tilesets") == 0 && t == JSON_ARRAY) {
+      while ((t = json_next(&json)) == JSON_OBJECT)
+        if (!read_json_tileset(add_tileset(map), &json, dir))
+          return false;
+      if (t != JSON_END_ARRAY)
+        return json_fail(&json);
+    }
+    else if (!json_skip(&json, t))
+      return json_fail(&json);
+  }
+
+  return t == JSON_END_OBJECT || json_fail(&json);
+}
+
+// reads the contents of a "layers" array, flattening group layers
+static bool read_json_layers(Map* map, JsonReader* json) {
+  JsonToken t;
+  while ((t = json_next(json)) == JSON_OBJECT) {
+    char type[32] = "";
+    char name[64] = "";
+    int w = 0, h = 0;
+    bool visible = true;
+    double opacity = 1;
+    Uint32* gids = NULL;
+    int num_gids = 0, max_gids = 0;
+
+    while ((t = json_next(json)) == JSON_KEY) {
+      char key[JSON_MAX_STR];
+      strcpy(key, json->str);
+      t = json_next(json);
+
+      if (strcmp(key, "type") == 0 && t == JSON_STRING)
+        snprintf(type, sizeof(type), "%s", json->str);
+      else if (strcmp(key, "name") == 0 && t == JSON_STRING)
+        snprintf(name, sizeof(name), "%s", json->str);
+      else if (strcmp(key, "width") == 0 && t == JSON_NUMBER)
+        w = json->num;
+      else if (strcmp(key, "height") == 0 && t == JSON_NUMBER)
+        h = json->num;
+      else if (strcmp(key, "visible") == 0)
+        visible = t != JSON_FALSE;
+      else if (strcmp(key, "opacity") == 0 && t == JSON_NUMBER)
+        opacity = json->num;
+      else if (strcmp(key, "data") == 0 && t == JSON_ARRAY) {
+        // gids go straight from the text into the layer's array
+        while ((t = json_next(json)) == JSON_NUMBER)
+          if (!push_gid(&gids, &num_gids, &max_gids, (Uint32)json->num)) {
+            free(gids);
+            return false;
+          }
+        if (t != JSON_END_ARRAY) {
+          free(gids);
+          return json_fail(json);
+        }
+      }
+      else if (strcmp(key, "data") == 0 && t == JSON_STRING) {
+        free(gids);
+        SDL_SetError("base64 layer data isn't supported (set the layer format to CSV)");
+        return false;
+      }
+      else if (strcmp(key, "layers") == 0 && t == JSON_ARRAY) {
+        if (!read_json_layers(map, json)) {
+          free(gids);
+          return false;
+        }
+      }
+      else if (!json_skip(json, t)) {
+        free(gids);
+        return json_fail(json);
+      }
+    }
+
+    if (t != JSON_END_OBJECT) {
+      free(gids);
+      return json_fail(json);
+    }
+
+    if (strcmp(type, "tilelayer") != 0) {
+      free(gids);
+      continue;
+    }
+
+    if (num_gids != w * h) {
+      free(gids);
+      SDL_SetError("layer '%s' has %d tiles, expected %dx%d", name, num_gids, w, h);
+      return false;
+    }
+
+    TileLayer* layer = add_layer(map);
+    if (!layer) {
+      free(gids);
+      return false;
+    }
+    snprintf(layer->name, sizeof(layer->name), "%s", name);
+    layer->w = w;
+    layer->h = h;
+    layer->visible = visible;
+    layer->opacity = clamp(opacity * 255, 0, 255);
+    layer->gids = gids;
+  }
+
+  return t == JSON_END_ARRAY || json_fail(json);
+}
+
+// reads the rest of a tileset object (embedded in a map or a whole .tsj file)
+static bool read_json_tileset(Tileset* tileset, JsonReader* json, char* dir) {
+  if (!tileset)
+    return false;
+
+  JsonToken t;
+  while ((t = json_next(json)) == JSON_KEY) {
+    char key[JSON_MAX_STR];
+    strcpy(key, json->str);
+    t = json_next(json);
+
+    if (strcmp(key, "firstgid") == 0 && t == JSON_NUMBER)
+      tileset->first_gid = json->num;
+    else if (strcmp(key, "tilewidth") == 0 && t == JSON_NUMBER)
+      tileset->tile_w = json->num;
+    else if (strcmp(key, "tileheight") == 0 && t == JSON_NUMBER)
+      tileset->tile_h = json->num;
+    else if (strcmp(key, "columns") == 0 && t == JSON_NUMBER)
+      tileset->columns = json->num;
+    else if (strcmp(key, "margin") == 0 && t == JSON_NUMBER)
+      tileset->margin = json->num;
+    else if (strcmp(key, "spacing") == 0 && t == JSON_NUMBER)
+      tileset->spacing = json->num;
+    else if (strcmp(key, "imagewidth") == 0 && t == JSON_NUMBER)
+      tileset->img_w = json->num;
+    else if (strcmp(key, "imageheight") == 0 && t == JSON_NUMBER)
+      tileset->img_h = json->num;
+    else if (strcmp(key, "image") == 0 && t == JSON_STRING)
+      join_path(dir, json->str, tileset->image);
+    else if (strcmp(key, "source") == 0 && t == JSON_STRING) {
+      char path[MAX_MAP_PATH];
+      join_path(dir, json->str, path);
+      if (!load_external_tileset(tileset, path))
+        return false;
+    }
+    else if (!json_skip(json, t))
+      return json_fail(json);
+  }
+
+  return t == JSON_END_OBJECT || json_fail(json);
+}
+
+// TMX (XML). Only what's needed for tile layers is read: <map>, <tileset>,
+// <image>, <layer> & CSV-encoded <data>.
+
+static bool load_tmx_map(Map* map, char* src, size_t len, char* dir) {
+  const char* pos = src;
+  const char* end = src + len;
+  Tileset* tileset = NULL;
+  TileLayer* layer = NULL;
+  int num_gids = 0, max_gids = 0;
+  char value[MAX_MAP_PATH];
+
+  XmlTag tag;
+  while (next_tag(&pos, end, &tag)) {
+    if (tag.is_closing) {
+      if (tag_is(&tag, "tileset"))
+        tileset = NULL;
+      else if (tag_is(&tag, "layer")) {
+        if (layer && !check_layer(layer, num_gids))
+          return false;
+        layer = NULL;
+      }
+      continue;
+    }
+
+    if (tag_is(&tag, "map")) {
+      if (tag_attr(&tag, "orientation", value, sizeof(value)) && strcmp(value, "orthogonal") != 0) {
+        SDL_SetError("only orthogonal maps are supported");
+        return false;
+      }
+      if (tag_int(&tag, "infinite", 0)) {
+        SDL_SetError("infinite maps aren't supported");
+        return false;
+      }
+      map->w = tag_int(&tag, "width", 0);
+      map->h = tag_int(&tag, "height", 0);
+      map->tile_w = tag_int(&tag, "tilewidth", 0);
+      map->tile_h = tag_int(&tag, "tileheight", 0);
+    }
+    else if (tag_is(&tag, "tileset")) {
+      tileset = add_tileset(map);
+      if (!tileset)
+        return false;
+
+      tileset->first_gid = tag_int(&tag, "firstgid", 1);
+      if (tag_attr(&tag, "source", value, sizeof(value))) {
+        char path[MAX_MAP_PATH];
+        join_path(dir, value, path);
+        if (!load_external_tileset(tileset, path))
+          return false;
+      }
+      else {
+        tileset->tile_w = tag_int(&tag, "tilewidth", 0);
+        tileset->tile_h = tag_int(&tag, "tileheight", 0);
+        tileset->columns = tag_int(&tag, "columns", 0);
+        tileset->margin = tag_int(&tag, "margin", 0);
+        tileset->spacing = tag_int(&tag, "spacing", 0);
+      }
+      if (tag.is_self_closing)
+        tileset = NULL;
+    }
+    else if (tag_is(&tag, "image") && tileset) {
+      if (tag_attr(&tag, "source", value, sizeof(value)))
+        join_path(dir, value, tileset->image);
+      tileset->img_w = tag_int(&tag, "width", 0);
+      tileset->img_h = tag_int(&tag, "height", 0);
+    }
+    else if (tag_is(&tag, "layer")) {
+      if (layer && !check_layer(layer, num_gids)) // (the last one wasn't closed)
+        return false;
+      layer = add_layer(map);
+      if (!layer)
+        return false;
+      if (tag_attr(&tag, "name", value, sizeof(value)))
+        snprintf(layer->name, sizeof(layer->name), "%s", value);
+      layer->w = tag_int(&tag, "width", 0);
+      layer->h = tag_int(&tag, "height", 0);
+      layer->visible = tag_int(&tag, "visible", 1);
+      if (tag_attr(&tag, "opacity", value, sizeof(value)))
+        layer->opacity = clamp(atof(value) * 255, 0, 255);
+      num_gids = max_gids = 0;
+      if (tag.is_self_closing) {
+        if (!check_layer(layer, num_gids))
+          return false;
+        layer = NULL;
+      }
+    }
+    else if (tag_is(&tag, "data") && layer) {
+      if (!tag_attr(&tag, "encoding", value, sizeof(value)) || strcmp(value, "csv") != 0) {
+        SDL_SetError("only CSV layer data is supported (set the layer format to CSV)");
+        return false;
+      }
+
+      if (num_gids) {
+        SDL_SetError("layer '%s' has more than one <data>", layer->name);
+        return false;
+      }
+      while (pos < end && *pos != '<') {
+        char* num_end;
+        Uint32 gid = strtoul(pos, &num_end, 10);
+        if (num_end == pos) {
+          pos++; // separator
+          continue;
+        }
+        if (!push_gid(&layer->gids, &num_gids, &max_gids, gid))
+          return false;
+        pos = num_end;
+      }
+    }
+  }
+
+  return !layer || check_layer(layer, num_gids);
+}
+
+// a TMX layer, once its <data> (if any) has been read
+static bool check_layer(TileLayer* layer, int num_gids) {
+  if (!layer->gids || num_gids != layer->w * layer->h) {
+    SDL_SetError("layer '%s' has %d tiles, expected %dx%d", layer->name, num_gids, layer->w, layer->h);
+    return false;
+  }
+  return true;
+}
+
+// .tsx (XML) or .tsj/.json tileset files
+static bool load_external_tileset(Tileset* tileset, char* path) {
+  size_t len;
+  char* src = read_file(path, &len);
+  if (!src) {
+    SDL_SetError("can't read tileset %s", path);
+    return false;
+  }
+
+  char dir[MAX_MAP_PATH];
+  dir_of(path, dir);
+  bool loaded = true;
+
+  if (ends_with(path, ".tsx")) {
+    const char* pos = src;
+    XmlTag tag;
+    char value[MAX_MAP_PATH];
+    while (next_tag(&pos, src + len, &tag)) {
+      if (tag.is_closing)
+        continue;
+
+      if (tag_is(&tag, "tileset")) {
+        tileset->tile_w = tag_int(&tag, "tilewidth", 0);
+        tileset->tile_h = tag_int(&tag, "tileheight", 0);
+        tileset->columns = tag_int(&tag, "columns", 0);
+        tileset->margin = tag_int(&tag, "margin", 0);
+        tileset->spacing = tag_int(&tag, "spacing", 0);
+      }
+      else if (tag_is(&tag, "image")) {
+        if (tag_attr(&tag, "source", value, sizeof(value)))
+          join_path(dir, value, tileset->image);
+        tileset->img_w = tag_int(&tag, "width", 0);
+        tileset->img_h = tag_int(&tag, "height", 0);
+        break; // only single-image tilesets are supported
+      }
+    }
+  }
+  else {
+    // the external file doesn't know the firstgid; keep the map's
+    int first_gid = tileset->first_gid;
+    JsonReader json;
+    json_init(&json, src, len);
+    loaded = json_next(&json) == JSON_OBJECT ? read_json_tileset(tileset, &json, dir) : json_fail(&json);
+    tileset->first_gid = first_gid;
+  }
+
+  free(src);
+  return loaded;
+}
+
+static bool json_fail(JsonReader* json) {
+  SDL_SetError("bad JSON: %s", json->err[0] ? json->err : "unexpected value");
+  return false;
+}
+
+// finds the next element tag, skipping text, comments & <? ?>/<! > declarations
+static bool next_tag(const char** pos, const char* end, XmlTag* tag) {
+  const char* p = *pos;
+  while (p < end) {
+    while (p < end && *p != '<')
+      p++;
+    if (p + 1 >= end)
+      break;
+
+    if (p[1] == '!' || p[1] == '?') {
+      bool is_comment = p + 3 < end && p[2] == '-' && p[3] == '-';
+      p += 2;
+      while (p < end && !(is_comment ? (p + 2 < end && p[0] == '-' && p[1] == '-' && p[2] == '>') : *p == '>'))
+        p++;
+      p += is_comment ? 3 : 1;
+      continue;
+    }
+
+    p++;
+    tag->is_closing = *p == '/';
+    if (tag->is_closing)
+      p++;
+
+    tag->name = p;
+    while (p < end && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r' && *p != '>' && *p != '/')
+      p++;
+    tag->name_len = p - tag->name;
+
+    // attributes run to the closing '>' (which can't appear inside quotes)
+    tag->attrs = p;
+    char quote = 0;
+    while (p < end && (quote || *p != '>')) {
+      if (quote && *p == quote)
+        quote = 0;
+      else if (!quote && (*p == '"' || *p == '\''))
+        quote = *p;
+      p++;
+    }
+    tag->attrs_end = p;
+    tag->is_self_closing = p > tag->attrs && p[-1] == '/';
+
+    *pos = p < end ? p + 1 : end;
+    return true;
+  }
+
+  *pos = end;
+  return false;
+}
+
+static bool tag_is(XmlTag* tag, char* name) {
+  return tag->name_len == (int)strlen(name) && strncmp(tag->name, name, tag->name_len) == 0;
+}
+
+// copies the attribute's (unescaped) value into out; false if it isn't there
+static bool tag_attr(XmlTag* tag, char* name, char* out, int out_len) {
+  int name_len = strlen(name);
+  const char* p = tag->attrs;
+  while (p < tag->attrs_end) {
+    while (p < tag->attrs_end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == '/'))
+      p++;
+
+    const char* attr = p;
+    while (p < tag->attrs_end && *p != '=' && *p != ' ')
+      p++;
+    int attr_len = p - attr;
+
+    while (p < tag->attrs_end && *p != '"' && *p != '\'')
+      p++;
+    if (p >= tag->attrs_end)
+      return false;
+
+    char quote = *p++;
+    const char* val = p;
+    while (p < tag->attrs_end && *p != quote)
+      p++;
+
+    if (attr_len == name_len && strncmp(attr, name, name_len) == 0) {
+      int len = p - val < out_len - 1 ? p - val : out_len - 1;
+      memcpy(out, val, len);
+      out[len] = '\0';
+      return true;
+    }
+    p++;
+  }
+  return false;
+}
+
+static int tag_int(XmlTag* tag, char* name, int def) {
+  char value[32];
+  return tag_attr(tag, name, value, sizeof(value)) ? atoi(value) : def;
+}
+
+static TileLayer* add_layer(Map* map) {
+  TileLayer* layers = realloc(map->layers, (map->num_layers + 1) * sizeof(TileLayer));
+  if (!layers) {
+    SDL_SetError("out of memory for map layers");
+    return NULL;
+  }
+  map->layers = layers;
+
+  TileLayer* layer = &map->layers[map->num_layers++];
+  memset(layer, 0, sizeof(TileLayer));
+  layer->visible = true;
+  layer->opacity = 255;
+  return layer;
+}
+
+static Tileset* add_tileset(Map* map) {
+  if (map->num_tilesets == MAX_TILESETS) {
+    SDL_SetError("maps can't have more than %d tilesets", MAX_TILESETS);
+    return NULL;
+  }
+
+  Tileset* tileset = &map->tilesets[map->num_tilesets++];
+  memset(tileset, 0, sizeof(Tileset));
+  return tileset;
+}
+
+static bool push_gid(Uint32** gids, int* num, int* cap, Uint32 gid) {
+  if (*num == *cap) {
+    Uint32* grown = realloc(*gids, (*cap ? *cap * 2 : 1024) * sizeof(Uint32));
+    if (!grown) {
+      SDL_SetError("out of memory for map layer");
+      return false;
+    }
+    *gids = grown;
+    *cap = *cap ? *cap * 2 : 1024;
+  }
+  (*gids)[(*num)++] = gid;
+  return true;
+}
+
+// "maps/level1.tmx" -> "maps/"
+static void dir_of(char* path, char* dir) {
+  char* slash = strrchr(path, '/');
+  char* backslash = strrchr(path, '\\');
+  if (backslash > slash)
+    slash = backslash;
+
+  int len = slash ? slash - path + 1 : 0;
+  if (len >= MAX_MAP_PATH)
+    len = 0;
+  memcpy(dir, path, len);
+  dir[len] = '\0';
+}
+
+static void join_path(char* dir, char* file, char* out) {
+  bool is_absolute = file[0] == '/' || file[0] == '\\' || (file[0] && file[1] == ':');
+  snprintf(out, MAX_MAP_PATH, "%s%s", is_absolute ? "" : dir, file);
+}
+
+static bool ends_with(char* str, char* suffix) {
+  size_t len = strlen(str);
+  size_t suffix_len = strlen(suffix);
+  return len >= suffix_len && strcmp(str + len - suffix_len, suffix) == 0;
+}
+
+static int floor_div(int a, int b) {
+  return a >= 0 ? a / b : (a - b + 1) / b;
+}
+
+// tilesets are sorted by first_gid, so it's the last one that starts at or before the gid
+static Tileset* tileset_for(Map* map, Uint32 gid) {
+  for (int t = map->num_tilesets - 1; t >= 0; --t)
+    if (map->tilesets[t].first_gid <= (int)gid)
+      return &map->tilesets[t];
+  return NULL;
+}
+
+// renders the chunk's tiles into its texture (once); chunks without any tiles
+// are just marked empty
+static void bake_chunk(Map* map, TileLayer* layer, int cx, int cy, SDL_Renderer* renderer) {
+  Chunk* chunk = &layer->chunks[cy * layer->chunks_w + cx];
+  int tx1 = cx * CHUNK_TILES;
+  int ty1 = cy * CHUNK_TILES;
+  int tx2 = tx1 + CHUNK_TILES < layer->w ? tx1 + CHUNK_TILES : layer->w;
+  int ty2 = ty1 + CHUNK_TILES < layer->h ? ty1 + CHUNK_TILES : layer->h;
+
+  bool is_empty = true;
+  for (int ty = ty1; ty < ty2 && is_empty; ++ty)
+    for (int tx = tx1; tx < tx2 && is_empty; ++tx)
+      if (layer->gids[ty * layer->w + tx] & GID_MASK)
+        is_empty = false;
+
+  if (is_empty) {
+    chunk->state = CHUNK_EMPTY;
+    return;
+  }
+
+  if (!chunk->tex) {
+    chunk->tex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, (tx2 - tx1) * map->tile_w, (ty2 - ty1) * map->tile_h);
+    if (!chunk->tex)
+      error("creating map chunk texture");
+    if (SDL_SetTextureBlendMode(chunk->tex, SDL_BLENDMODE_BLEND) < 0 || SDL_SetTextureAlphaMod(chunk->tex, layer->opacity) < 0)
+      error("setting map chunk blending");
+  }
+
+  Uint8 r, g, b, a;
+  SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+  SDL_Texture* prev_target = SDL_GetRenderTarget(renderer);
+  if (SDL_SetRenderTarget(renderer, chunk->tex) < 0)
+    error("baking map chunk");
+  if (SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0) < 0 || SDL_RenderClear(renderer) < 0)
+    error("clearing map chunk");
+
+  for (int ty = ty1; ty < ty2; ++ty) {
+    for (int tx = tx1; tx < tx2; ++tx) {
+      Uint32 raw = layer->gids[ty * layer->w + tx];
+      Uint32 gid = raw & GID_MASK;
+      Tileset* tileset = gid ? tileset_for(map, gid) : NULL;
+      if (!tileset || !tileset->tex || tileset->columns <= 0)
+        continue;
+
+      int index = gid - tileset->first_gid;
+      SDL_Rect src = {
+        .x = tileset->margin + (index % tileset->columns) * (tileset->tile_w + tileset->spacing),
+        .y = tileset->margin + (index / tileset->columns) * (tileset->tile_h + tileset->spacing),
+        .w = tileset->tile_w,
+        .h = tileset->tile_h
+      };
+
+      // like Tiled, oversized tiles are anchored to the bottom-left of their cell
+      // (anything that spills past the chunk's edge is clipped)
+      SDL_Rect dest = {
+        .x = (tx - tx1) * map->tile_w,
+        .y = (ty - ty1 + 1) * map->tile_h - tileset->tile_h,
+        .w = tileset->tile_w,
+        .h = tileset->tile_h
+      };
+
+      int flip = (raw & GID_FLIP_H ? SDL_FLIP_HORIZONTAL : 0) | (raw & GID_FLIP_V ? SDL_FLIP_VERTICAL : 0);
+      if (SDL_RenderCopyEx(renderer, tileset->tex, &src, &dest, 0, NULL, flip) < 0)
+        error("rendering tile");
+    }
+  }
+
+  if (SDL_SetRenderTarget(renderer, prev_target) < 0)
+    error("restoring render target");
+  SDL_SetRenderDrawColor(renderer, r, g, b, a);
+  chunk->state = CHUNK_BAKED;
+}
@@ -0,0 +1,76 @@
+#ifndef MAP_H
+#define MAP_H
+
+#include <stdbool.h>
+
+#include "SDL.h"
+#include "red-planet.h"
+
+// Tiled (https://www.mapeditor.org) map support.
+//
+// Orthogonal, finite maps saved as JSON (.json/.tmj) or TMX with CSV layer
+// data are supported, with embedded or external (.tsx) tilesets.
+//
+// Tile layers are static, so each one is split into CHUNK_TILES x CHUNK_TILES
+// chunks that are rendered into their own target texture the first time they
+// come into view and are then drawn as a single quad. Only chunks that
+// intersect the viewport are drawn (or baked).
+
+#define CHUNK_TILES 32
+#define MAX_TILESETS 16
+#define MAX_MAP_PATH 512
+
+// Tiled stores flip flags in the top bits of each gid
+#define GID_FLIP_H 0x80000000u
+#define GID_FLIP_V 0x40000000u
+#define GID_MASK 0x0FFFFFFFu
+
+typedef struct {
+  int first_gid;
+  int tile_w;
+  int tile_h;
+  int columns;
+  int margin;
+  int spacing;
+  int img_w;
+  int img_h;
+  char image[MAX_MAP_PATH]; // resolved relative to the map (or .tsx) file
+  SDL_Texture* tex;         // set by the loader; owned by the texture cache (assets.c)
+} Tileset;
+
+enum { CHUNK_UNBAKED, CHUNK_BAKED, CHUNK_EMPTY };
+
+typedef struct {
+  SDL_Texture* tex;
+  byte state;
+} Chunk;
+
+typedef struct {
+  char name[64];
+  int w;          // in tiles
+  int h;
+  bool visible;
+  byte opacity;
+  Uint32* gids;   // w*h, row-major
+  int chunks_w;
+  int chunks_h;
+  Chunk* chunks;
+} TileLayer;
+
+typedef struct {
+  int w;          // in tiles
+  int h;
+  int tile_w;     // in px
+  int tile_h;
+  Tileset tilesets[MAX_TILESETS];
+  int num_tilesets;
+  TileLayer* layers;
+  int num_layers;
+} Map;
+
+bool map_load(Map* map, char* path);
+void map_render(Map* map, SDL_Renderer* renderer, Viewport* viewport);
+void map_invalidate(Map* map);
+void map_free(Map* map);
+
+#endif
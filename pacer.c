@@ -0,0 +1,56 @@
+#include "SDL.h"
+#include "pacer.h"
+
+// how close to the deadline we stop sleeping (SDL_Delay() can overshoot by ~1-2ms)
+#define SPIN_MS 2
+
+// max_fps of 0 paces to the display's refresh rate (falling back to 60 Hz)
+void pacer_init(FramePacer* pacer, SDL_Window* window, SDL_Renderer* renderer, int max_fps) {
+  pacer->freq = SDL_GetPerformanceFrequency();
+  pacer->frame_len = 0;
+
+  SDL_RendererInfo info;
+  bool has_vsync = SDL_GetRendererInfo(renderer, &info) == 0 && (info.flags & SDL_RENDERER_PRESENTVSYNC);
+
+  int refresh_rate = 0;
+  SDL_DisplayMode mode;
+  if (SDL_GetWindowDisplayMode(window, &mode) == 0)
+    refresh_rate = mode.refresh_rate;
+
+  // a vsync'd present already blocks until the next refresh; only pace below that
+  bool below_refresh = max_fps > 0 && (refresh_rate <= 0 || max_fps < refresh_rate);
+  if (!has_vsync || below_refresh) {
+    int fps = max_fps > 0 ? max_fps : refresh_rate > 0 ? refresh_rate : 60;
+    pacer->frame_len = pacer->freq / fps;
+  }
+
+  pacer_reset(pacer);
+}
+
+// restarts the schedule from now (e.g. after a pause)
+void pacer_reset(FramePacer* pacer) {
+  pacer->next_frame = SDL_GetPerformanceCounter() + pacer->frame_len;
+}
+
+// blocks until the current frame's deadline
+void pacer_wait(FramePacer* pacer) {
+  if (!pacer->frame_len)
+    return;
+
+  Uint64 now = SDL_GetPerformanceCounter();
+  Uint64 spin = pacer->freq * SPIN_MS / 1000;
+  while (now < pacer->next_frame) {
+    Uint64 left = pacer->next_frame - now;
+    if (left > spin)
+      SDL_Delay((Uint32)((left - spin) * 1000 / pacer->freq));
+    else
+      SDL_Delay(0); // yield
+    now = SDL_GetPerformanceCounter();
+  }
+
+  // schedule the next frame from the deadline (not from now) so error doesn't
+  // accumulate, unless we've fallen more than a frame behind
+  pacer->next_frame += pacer->frame_len;
+  if (pacer->next_frame < now)
+    pacer->next_frame = now + pacer->frame_len;
+}
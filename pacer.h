@@ -0,0 +1,25 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include <stdbool.h>
+
+#include "SDL.h"
+
+// Frame pacing for the render loop.
+//
+// With a vsync'd renderer SDL_RenderPresent() already blocks until the next
+// refresh, so the pacer does nothing. Otherwise it waits out the rest of each
+// frame: it sleeps while there's more than a scheduler quantum left and
+// yields/spins for the remainder, so frames land on time without the
+// millisecond truncation of a fixed SDL_Delay().
+typedef struct {
+  Uint64 freq;
+  Uint64 frame_len;   // counter ticks per frame; 0 = unpaced
+  Uint64 next_frame;
+} FramePacer;
+
+void pacer_init(FramePacer* pacer, SDL_Window* window, SDL_Renderer* renderer, int max_fps);
+void pacer_reset(FramePacer* pacer);
+void pacer_wait(FramePacer* pacer);
+
+#endif
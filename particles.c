@@ -0,0 +1,155 @@
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+#include "SDL.h"
+#include "red-planet.h"
+#include "particles.h"
+
+static void step(Particles* particles, float dt, float drag);
+static void move_particle(Particles* particles, int dst, int src);
+static float random_unit(Particles* particles);
+
+// room for `max` particles, for the rest of the level
+void particles_init(Particles* particles, Arena* arena, int max) {
+  // never 0 bytes, so there are always valid arrays
+  size_t len = (max > 0 ? max : 1) * sizeof(float);
+  particles->count = 0;
+  particles->max = max;
+  particles->rng = 2463534242u;
+  particles->x = arena_alloc(arena, len);
+  particles->y = arena_alloc(arena, len);
+  particles->dx = arena_alloc(arena, len);
+  particles->dy = arena_alloc(arena, len);
+  particles->life = arena_alloc(arena, len);
+  particles->inv_life = arena_alloc(arena, len);
+  particles->size = arena_alloc(arena, len);
+  particles->color = arena_alloc(arena, (max > 0 ? max : 1) * sizeof(SDL_Color));
+}
+
+// `num` particles flying out of x,y in random directions, at up to `speed`
+// px/sec, for up to `life` sec (each gets between half & all of both)
+void particles_burst(Particles* particles, float x, float y, int num, float speed, float life, float size, SDL_Color color) {
+  if (num > particles->max - particles->count)
+    num = particles->max - particles->count;
+
+  for (int n = 0; n < num; ++n) {
+    int i = particles->count++;
+    float angle = random_unit(particles) * 2 * (float)M_PI;
+    float v = speed * (0.5f + 0.5f * random_unit(particles));
+    float t = life * (0.5f + 0.5f * random_unit(particles));
+    particles->x[i] = x;
+    particles->y[i] = y;
+    particles->dx[i] = cosf(angle) * v;
+    particles->dy[i] = sinf(angle) * v;
+    particles->life[i] = t;
+    particles->inv_life[i] = 1 / t;
+    particles->size[i] = size;
+    particles->color[i] = color;
+  }
+}
+
+// moves & ages every particle by dt sec, then recycles the ones that died
+void particles_update(Particles* particles, float dt) {
+  step(particles, dt, expf(-PARTICLE_DRAG * dt));
+
+  // walk backwards so the particle moved into a hole has already been checked
+  for (int i = particles->count - 1; i >= 0; --i)
+    if (particles->life[i] <= 0)
+      move_particle(particles, i, --particles->count);
+}
+
+// queues every particle in view; `lag` is how many sec behind the last tick
+// the frame is, since particles are drawn on their current heading rather
+// than interpolated from a saved position
+void particles_render(Particles* particles, SpriteBatch* batch, Viewport* viewport, float lag) {
+  float min_x = viewport->x;
+  float min_y = viewport->y;
+  float max_x = viewport->x + viewport->w;
+  float max_y = viewport->y + viewport->h + header_height;
+
+  for (int i = 0; i < particles->count; ++i) {
+    float half = particles->size[i] / 2;
+    float x = particles->x[i] - particles->dx[i] * lag;
+    float y = particles->y[i] - particles->dy[i] * lag;
+    if (x + half <= min_x || x - half >= max_x || y + half <= min_y || y - half >= max_y)
+      continue;
+
+    SDL_Color color = particles->color[i];
+    color.a = color.a * fminf(particles->life[i] * particles->inv_life[i], 1);
+    SDL_FRect dest = {x - half - viewport->x, y - half - viewport->y, particles->size[i], particles->size[i]};
+    batch_rect(batch, &dest, color);
+  }
+}
+
+// x += dx * dt, y += dy * dt, dx *= drag, dy *= drag, life -= dt (vectorized)
+static void step(Particles* particles, float dt, float drag) {
+  float* x = particles->x;
+  float* y = particles->y;
+  float* dx = particles->dx;
+  float* dy = particles->dy;
+  float* life = particles->life;
+  int num = particles->count;
+  int i = 0;
+
+#if defined(__AVX__)
+  __m256 dt8 = _mm256_set1_ps(dt);
+  __m256 drag8 = _mm256_set1_ps(drag);
+  for (; i + 8 <= num; i += 8) {
+    __m256 vx = _mm256_load_ps(dx + i);
+    __m256 vy = _mm256_load_ps(dy + i);
+    _mm256_store_ps(x + i, _mm256_add_ps(_mm256_load_ps(x + i), _mm256_mul_ps(vx, dt8)));
+    _mm256_store_ps(y + i, _mm256_add_ps(_mm256_load_ps(y + i), _mm256_mul_ps(vy, dt8)));
+    _mm256_store_ps(dx + i, _mm256_mul_ps(vx, drag8));
+    _mm256_store_ps(dy + i, _mm256_mul_ps(vy, drag8));
+    _mm256_store_ps(life + i, _mm256_sub_ps(_mm256_load_ps(life + i), dt8));
+  }
+#elif defined(__SSE__) || defined(_M_X64)
+  __m128 dt4 = _mm_set1_ps(dt);
+  __m128 drag4 = _mm_set1_ps(drag);
+  for (; i + 4 <= num; i += 4) {
+    __m128 vx = _mm_load_ps(dx + i);
+    __m128 vy = _mm_load_ps(dy + i);
+    _mm_store_ps(x + i, _mm_add_ps(_mm_load_ps(x + i), _mm_mul_ps(vx, dt4)));
+    _mm_store_ps(y + i, _mm_add_ps(_mm_load_ps(y + i), _mm_mul_ps(vy, dt4)));
+    _mm_store_ps(dx + i, _mm_mul_ps(vx, drag4));
+    _mm_store_ps(dy + i, _mm_mul_ps(vy, drag4));
+    _mm_store_ps(life + i, _mm_sub_ps(_mm_load_ps(life + i), dt4));
+  }
+#endif
+
+  // scalar fallback & remainder
+  for (; i < num; ++i) {
+    x[i] += dx[i] * dt;
+    y[i] += dy[i] * dt;
+    dx[i] *= drag;
+    dy[i] *= drag;
+    life[i] -= dt;
+  }
+}
+
+static void move_particle(Particles* particles, int dst, int src) {
+  particles->x[dst] = particles->x[src];
+  particles->y[dst] = particles->y[src];
+  particles->dx[dst] = particles->dx[src];
+  particles->dy[dst] = particles->dy[src];
+  particles->life[dst] = particles->life[src];
+  particles->inv_life[dst] = particles->inv_life[src];
+  particles->size[dst] = particles->size[src];
+  particles->color[dst] = particles->color[src];
+}
+
+// [0, 1), from xorshift32
+static float random_unit(Particles* particles) {
+  Uint32 r = particles->rng;
+  r ^= r << 13;
+  r ^= r >> 17;
+  r ^= r << 5;
+  particles->rng = r;
+  return (r >> 8) * (1.0f / 16777216);
+}
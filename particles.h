@@ -0,0 +1,45 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include "SDL.h"
+#include "arena.h"
+#include "batch.h"
+#include "red-planet.h"
+
+// Particles for hit & death effects.
+//
+// Particles aren't entities: they have no ids, flags or collisions, just their
+// own structure-of-arrays storage (allocated once per level, at the max, from
+// the level's arena) & a vectorized kernel that moves them, slows them down &
+// ages them. Live particles are packed into [0, count); one that runs out of
+// life is replaced by the last live one, so its slot is reused by the next
+// burst & nothing is ever allocated per particle. Bursts that don't fit are
+// cut short.
+//
+// They're drawn as untextured, vertex-colored quads that fade out with age,
+// all in one batch. Particles are purely visual: they have their own random
+// state & aren't part of the World, so they never affect the simulation (or
+// its snapshots & checksums).
+
+#define PARTICLE_DRAG 4.0f // velocity lost per sec (exponential)
+
+typedef struct {
+  int count;
+  int max;
+  Uint32 rng;
+  float* x;         // px (center)
+  float* y;
+  float* dx;        // px/sec
+  float* dy;
+  float* life;      // sec left
+  float* inv_life;  // 1 / the life it started with, for fading
+  float* size;      // px
+  SDL_Color* color;
+} Particles;
+
+void particles_init(Particles* particles, Arena* arena, int max);
+void particles_burst(Particles* particles, float x, float y, int num, float speed, float life, float size, SDL_Color color);
+void particles_update(Particles* particles, float dt);
+void particles_render(Particles* particles, SpriteBatch* batch, Viewport* viewport, float lag);
+
+#endif
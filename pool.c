@@ -0,0 +1,174 @@
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+#include "SDL.h"
+#include "red-planet.h"
+
+static void grow(Pool* pool, int cap);
+static void* alloc_field(Pool* pool, void* old, int cap, size_t size);
+static void move_slot(Pool* pool, int dst, int src);
+
+// starts an empty pool that can grow to `max` entities
+void pool_init(Pool* pool, Arena* arena, byte kind, int max) {
+  pool->kind = kind;
+  pool->arena = arena;
+  pool->cap = 0;
+  pool->max = max;
+  pool->count = 0;
+  pool->num_free = 0;
+  pool->start_anim = ANIM_NONE;
+  grow(pool, max < POOL_BLOCK ? max : POOL_BLOCK);
+}
+
+// makes room for at least `cap` entities (up to the pool's max) without spawning any
+void pool_reserve(Pool* pool, int cap) {
+  if (cap > pool->cap)
+    grow(pool, cap);
+}
+
+// O(1) (amortized, when the pool has to grow): takes a free id and appends a
+// zeroed, live entity; returns its slot, or -1 if the pool is at its max
+int pool_spawn(Pool* pool) {
+  if (!pool->num_free) {
+    if (pool->cap == pool->max)
+      return -1;
+    grow(pool, pool->cap * 2 > pool->max ? pool->max : pool->cap * 2);
+  }
+
+  int id = pool->free_ids[--pool->num_free];
+  int slot = pool->count++;
+  pool->ids[slot] = id;
+  pool->slots[id] = slot;
+
+  pool->x[slot] = pool->y[slot] = 0;
+  pool->dx[slot] = pool->dy[slot] = 0;
+  pool->flags[slot] = pool->kind | SPAWNED;
+  pool->health[slot] = 0;
+  pool->anim[slot] = pool->start_anim;
+  pool->anim_step[slot] = 0;
+  pool->anim_time[slot] = 0;
+  return slot;
+}
+
+// O(1): frees the entity's id & fills its slot with the last live entity
+// this reorders slots, so don't call it while something else holds slot indices
+// (mark the entity DELETED and pool_sweep() later instead)
+void pool_despawn(Pool* pool, int slot) {
+  int id = pool->ids[slot];
+  int last = --pool->count;
+  if (slot != last) {
+    move_slot(pool, slot, last);
+    pool->slots[pool->ids[slot]] = slot;
+  }
+
+  pool->slots[id] = -1;
+  pool->free_ids[pool->num_free++] = id;
+}
+
+// despawns every entity marked DELETED since the last sweep
+void pool_sweep(Pool* pool) {
+  // walk backwards so the entity swapped into a hole has already been checked
+  for (int i = pool->count - 1; i >= 0; --i)
+    if (pool->flags[i] & DELETED)
+      pool_despawn(pool, i);
+}
+
+// records where every entity is before this tick moves it; render() interpolates
+// from here. Entities spawned since the last call have no previous position &
+// carry SPAWNED until now, so they're drawn where they are rather than lerped from 0,0
+void pool_save_positions(Pool* pool) {
+  memcpy(pool->prev_x, pool->x, pool->count * sizeof(float));
+  memcpy(pool->prev_y, pool->y, pool->count * sizeof(float));
+  for (int i = 0; i < pool->count; ++i)
+    pool->flags[i] &= ~SPAWNED;
+}
+
+// x += dx * scale, y += dy * scale for `num` contiguous entities
+// entities marked DELETED this tick are integrated too: it's cheaper to move a
+// few dead entities than to branch per entity, and callers skip them afterwards
+void integrate(float* x, float* y, const float* dx, const float* dy, int num, float scale) {
+  int i = 0;
+
+#if defined(__AVX__)
+  __m256 s8 = _mm256_set1_ps(scale);
+  for (; i + 8 <= num; i += 8) {
+    _mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(_mm256_loadu_ps(dx + i), s8)));
+    _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(_mm256_loadu_ps(dy + i), s8)));
+  }
+#elif defined(__SSE__) || defined(_M_X64)
+  __m128 s4 = _mm_set1_ps(scale);
+  for (; i + 4 <= num; i += 4) {
+    _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(_mm_loadu_ps(dx + i), s4)));
+    _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(_mm_loadu_ps(dy + i), s4)));
+  }
+#endif
+
+  // scalar fallback & remainder
+  for (; i < num; ++i) {
+    x[i] += dx[i] * scale;
+    y[i] += dy[i] * scale;
+  }
+}
+
+// reallocates every field for `cap` entities (rounded up to whole blocks),
+// keeping the live ones; the new ids go on the free stack
+static void grow(Pool* pool, int cap) {
+  if (cap > POOL_BLOCK)
+    cap = (cap + POOL_BLOCK - 1) / POOL_BLOCK * POOL_BLOCK;
+  if (cap > pool->max)
+    cap = pool->max;
+
+  pool->x = alloc_field(pool, pool->x, cap, sizeof(float));
+  pool->y = alloc_field(pool, pool->y, cap, sizeof(float));
+  pool->prev_x = alloc_field(pool, pool->prev_x, cap, sizeof(float));
+  pool->prev_y = alloc_field(pool, pool->prev_y, cap, sizeof(float));
+  pool->dx = alloc_field(pool, pool->dx, cap, sizeof(float));
+  pool->dy = alloc_field(pool, pool->dy, cap, sizeof(float));
+  pool->flags = alloc_field(pool, pool->flags, cap, sizeof(byte));
+  pool->health = alloc_field(pool, pool->health, cap, sizeof(byte));
+  pool->anim = alloc_field(pool, pool->anim, cap, sizeof(byte));
+  pool->anim_step = alloc_field(pool, pool->anim_step, cap, sizeof(byte));
+  pool->anim_time = alloc_field(pool, pool->anim_time, cap, sizeof(float));
+  pool->ids = alloc_field(pool, pool->ids, cap, sizeof(int));
+  pool->slots = alloc_field(pool, pool->slots, cap, sizeof(int));
+  pool->free_ids = alloc_field(pool, pool->free_ids, cap, sizeof(int));
+
+  // push the new ids in reverse so they're handed out in order
+  for (int id = cap - 1; id >= pool->cap; --id) {
+    pool->slots[id] = -1;
+    pool->free_ids[pool->num_free++] = id;
+  }
+  pool->cap = cap;
+}
+
+// a copy of the old array's `pool->cap` elements, zero-padded to `cap`
+static void* alloc_field(Pool* pool, void* old, int cap, size_t size) {
+  // never 0 bytes, so an empty pool still has valid arrays
+  size_t len = (cap > 0 ? cap : 1) * size;
+  void* field = arena_alloc(pool->arena, len);
+  size_t old_len = old ? pool->cap * size : 0;
+  if (old_len)
+    memcpy(field, old, old_len);
+  memset((byte*)field + old_len, 0, len - old_len);
+  return field;
+}
+
+static void move_slot(Pool* pool, int dst, int src) {
+  pool->x[dst] = pool->x[src];
+  pool->y[dst] = pool->y[src];
+  pool->prev_x[dst] = pool->prev_x[src];
+  pool->prev_y[dst] = pool->prev_y[src];
+  pool->dx[dst] = pool->dx[src];
+  pool->dy[dst] = pool->dy[src];
+  pool->flags[dst] = pool->flags[src];
+  pool->health[dst] = pool->health[src];
+  pool->anim[dst] = pool->anim[src];
+  pool->anim_step[dst] = pool->anim_step[src];
+  pool->anim_time[dst] = pool->anim_time[src];
+  pool->ids[dst] = pool->ids[src];
+}
@@ -0,0 +1,59 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include "arena.h"
+
+typedef unsigned char byte;
+
+// Structure-of-arrays entity pool.
+//
+// Every field lives in its own contiguous (SIMD-aligned) array, indexed by
+// entity slot, so the movement kernel streams through positions & velocities
+// without touching flags or health.
+//
+// Live entities are always packed into slots [0, count): spawning appends and
+// despawning moves the last live entity into the hole, so loops only ever
+// visit live entities. Because slots move, each entity also has a stable id
+// (ids[slot], slots[id]); free ids are kept on a stack.
+//
+// Fields are allocated from the level's arena. A pool starts at POOL_BLOCK
+// entities (or its max, if that's smaller) and doubles, in whole blocks, when
+// it fills up, until it reaches its max. The old arrays are simply left in the
+// arena, which is reset when the level ends.
+#define POOL_BLOCK 1024
+
+#define ANIM_NONE 0xFF // no animation: drawn with the plain spritesheet sprite
+
+typedef struct {
+  byte kind;      // PLAYER, ENEMY, BULLET, ... (shared by the whole pool)
+  Arena* arena;
+  int cap;        // allocated
+  int max;        // cap never grows past this
+  byte start_anim; // animation new entities start with (see anim.h)
+  int count;      // number of live entities
+  float* x;       // px
+  float* y;
+  float* prev_x;  // position as of the start of the current tick, for render interpolation
+  float* prev_y;
+  float* dx;      // direction of travel; scaled by the pool's speed
+  float* dy;
+  byte* flags;
+  byte* health;
+  byte* anim;     // index into the atlas' animations, or ANIM_NONE
+  byte* anim_step;
+  float* anim_time; // ms on the current step
+  int* ids;       // slot -> id, for slots [0, count)
+  int* slots;     // id -> slot, or -1 if the id is free
+  int* free_ids;
+  int num_free;
+} Pool;
+
+void pool_init(Pool* pool, Arena* arena, byte kind, int max);
+void pool_reserve(Pool* pool, int cap);
+int pool_spawn(Pool* pool);
+void pool_despawn(Pool* pool, int slot);
+void pool_sweep(Pool* pool);
+void pool_save_positions(Pool* pool);
+void integrate(float* x, float* y, const float* dx, const float* dy, int num, float scale);
+
+#endif
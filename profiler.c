@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "red-planet.h"
+#include "profiler.h"
+#include "text.h"
+
+// frames averaged (& graphed) by the overlay
+#define OVERLAY_FRAMES 120
+
+static char* phase_names[NUM_PHASES] = {"events", "update", "world", "hud", "present", "sleep"};
+
+static FrameSample frames[PROF_FRAMES];
+static FrameSample current = {};
+static SDL_atomic_t num_frames = {}; // frames published so far (frame n lives at n % PROF_FRAMES)
+static bool show_overlay = false;
+
+static double to_ms(Uint64 counter_ticks);
+
+void prof_begin_frame() {
+  memset(&current, 0, sizeof(FrameSample));
+  current.start = SDL_GetPerformanceCounter();
+}
+
+// copies the frame into the ring & publishes it
+void prof_end_frame() {
+  current.len = SDL_GetPerformanceCounter() - current.start;
+
+  int n = SDL_AtomicGet(&num_frames);
+  frames[n & (PROF_FRAMES - 1)] = current;
+  SDL_MemoryBarrierRelease();
+  SDL_AtomicSet(&num_frames, n + 1);
+}
+
+void prof_begin(int phase) {
+  Uint64 now = SDL_GetPerformanceCounter();
+  if (!current.phase_start[phase])
+    current.phase_start[phase] = now;
+
+  // phase_len holds -start while the phase is open, so prof_end() is one add
+  current.phase_len[phase] -= now;
+}
+
+void prof_end(int phase) {
+  current.phase_len[phase] += SDL_GetPerformanceCounter();
+}
+
+void prof_toggle_overlay() {
+  show_overlay = !show_overlay;
+}
+
+// draws a frame-time graph into the x/y/w/h rect (the header) and a table of
+// current/avg/max ms per phase just below it
+void prof_render_overlay(SDL_Renderer* renderer, int x, int y, int w, int h) {
+  if (!show_overlay)
+    return;
+
+  int n = SDL_AtomicGet(&num_frames);
+  SDL_MemoryBarrierAcquire();
+  int count = n < OVERLAY_FRAMES ? n : OVERLAY_FRAMES;
+  if (!count)
+    return;
+
+  // frame-time graph: one bar per frame, full height = 2 frames @ 60 fps
+  double budget_ms = 1000.0 / 60;
+  int graph_w = count < w ? count : w;
+  SDL_Rect ok_bars[OVERLAY_FRAMES];
+  SDL_Rect slow_bars[OVERLAY_FRAMES];
+  int num_ok = 0, num_slow = 0;
+  for (int i = 0; i < graph_w; ++i) {
+    double ms = to_ms(frames[(n - graph_w + i) & (PROF_FRAMES - 1)].len);
+    int bar_h = clamp((int)(ms / (budget_ms * 2) * h), 1, h);
+    SDL_Rect bar = {.x = x + i, .y = y + h - bar_h, .w = 1, .h = bar_h};
+    if (ms > budget_ms)
+      slow_bars[num_slow++] = bar;
+    else
+      ok_bars[num_ok++] = bar;
+  }
+
+  if (SDL_SetRenderDrawColor(renderer, 60, 180, 60, 255) < 0 || SDL_RenderFillRects(renderer, ok_bars, num_ok) < 0)
+    error("drawing frame graph");
+  if (SDL_SetRenderDrawColor(renderer, 220, 60, 60, 255) < 0 || SDL_RenderFillRects(renderer, slow_bars, num_slow) < 0)
+    error("drawing frame graph");
+
+  // per-phase table
+  int line_h = 10;
+  SDL_Rect panel = {.x = x, .y = y + h, .w = 30 * 8 + 8, .h = (NUM_PHASES + 2) * line_h + 4};
+  if (SDL_SetRenderDrawColor(renderer, 0, 0, 0, 200) < 0 || SDL_RenderFillRect(renderer, &panel) < 0)
+    error("drawing profiler panel");
+  if (SDL_SetRenderDrawColor(renderer, 200, 200, 200, 255) < 0)
+    error("setting profiler text color");
+
+  char line[40];
+  int line_y = panel.y + 4;
+  snprintf(line, sizeof(line), "%-8s %6s %6s %6s", "ms", "cur", "avg", "max");
+  render_text(renderer, line, panel.x + 4, line_y, 1);
+  for (int p = 0; p <= NUM_PHASES; ++p) {
+    // the last row is the whole frame
+    double cur = 0, total = 0, max = 0;
+    for (int i = 0; i < count; ++i) {
+      FrameSample* frame = &frames[(n - 1 - i) & (PROF_FRAMES - 1)];
+      double ms = to_ms(p < NUM_PHASES ? frame->phase_len[p] : frame->len);
+      if (i == 0)
+        cur = ms;
+      total += ms;
+      if (ms > max)
+        max = ms;
+    }
+
+    line_y += line_h;
+    snprintf(line, sizeof(line), "%-8s %6.2f %6.2f %6.2f", p < NUM_PHASES ? phase_names[p] : "frame", cur, total / count, max);
+    render_text(renderer, line, panel.x + 4, line_y, 1);
+  }
+}
+
+// writes every frame still in the ring; a path ending in .json gets Chrome
+// trace format (chrome://tracing, Perfetto), anything else gets CSV
+bool prof_dump(char* path) {
+  FILE* file = fopen(path, "w");
+  if (!file)
+    return false;
+
+  int n = SDL_AtomicGet(&num_frames);
+  SDL_MemoryBarrierAcquire();
+  int first = n > PROF_FRAMES ? n - PROF_FRAMES : 0;
+  Uint64 origin = n ? frames[first & (PROF_FRAMES - 1)].start : 0;
+  double us_per_tick = 1000000.0 / SDL_GetPerformanceFrequency();
+
+  size_t len = strlen(path);
+  bool is_json = len >= 5 && strcmp(path + len - 5, ".json") == 0;
+  if (is_json) {
+    fprintf(file, "{\"traceEvents\":[\n");
+    bool needs_comma = false;
+    for (int f = first; f < n; ++f) {
+      FrameSample* frame = &frames[f & (PROF_FRAMES - 1)];
+      fprintf(file, "%s{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.1f,\"dur\":%.1f}",
+        needs_comma ? ",\n" : "", (frame->start - origin) * us_per_tick, frame->len * us_per_tick);
+      needs_comma = true;
+      for (int p = 0; p < NUM_PHASES; ++p) {
+        if (!frame->phase_start[p])
+          continue;
+        fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.1f,\"dur\":%.1f}",
+          phase_names[p], (frame->phase_start[p] - origin) * us_per_tick, frame->phase_len[p] * us_per_tick);
+      }
+    }
+    fprintf(file, "\n]}\n");
+  }
+  else {
+    fprintf(file, "frame,start_ms,frame_ms");
+    for (int p = 0; p < NUM_PHASES; ++p)
+      fprintf(file, ",%s_ms", phase_names[p]);
+    fprintf(file, "\n");
+
+    for (int f = first; f < n; ++f) {
+      FrameSample* frame = &frames[f & (PROF_FRAMES - 1)];
+      fprintf(file, "%d,%.3f,%.3f", f, to_ms(frame->start - origin), to_ms(frame->len));
+      for (int p = 0; p < NUM_PHASES; ++p)
+        fprintf(file, ",%.3f", to_ms(frame->phase_len[p]));
+      fprintf(file, "\n");
+    }
+  }
+
+  return fclose(file) == 0;
+}
+
+static double to_ms(Uint64 counter_ticks) {
+  return counter_ticks * 1000.0 / SDL_GetPerformanceFrequency();
+}
@@ -0,0 +1,42 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+
+#include "SDL.h"
+
+// Per-phase frame profiler.
+//
+// prof_begin()/prof_end() pairs time each phase of a frame with the
+// performance counter; a phase entered several times in one frame (e.g.
+// update() when catching up) accumulates. Finished frames are published into
+// a ring buffer with a single atomic store, so readers (the overlay, the
+// exit dump, or another thread) never block the game loop.
+enum {
+  PHASE_EVENTS,
+  PHASE_UPDATE,
+  PHASE_RENDER_WORLD,
+  PHASE_RENDER_HUD,
+  PHASE_PRESENT,
+  PHASE_SLEEP,
+  NUM_PHASES
+};
+
+#define PROF_FRAMES 8192 // ring size, must be a power of 2
+
+typedef struct {
+  Uint64 start;
+  Uint64 len;
+  Uint64 phase_start[NUM_PHASES];
+  Uint64 phase_len[NUM_PHASES];
+} FrameSample;
+
+void prof_begin_frame();
+void prof_end_frame();
+void prof_begin(int phase);
+void prof_end(int phase);
+void prof_toggle_overlay();
+void prof_render_overlay(SDL_Renderer* renderer, int x, int y, int w, int h);
+bool prof_dump(char* path);
+
+#endif
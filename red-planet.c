@@ -4,93 +4,183 @@
 #include <stdio.h>
 #include <math.h>
 #include <limits.h>
+#include <string.h>
 
 #include "SDL.h"
 #include "SDL_image.h"
 #include "SDL_mixer.h"
-#include "font8x8_basic.h"
-
-typedef unsigned char byte;
-
-// entity flags
-#define DELETED 0x1
-#define PLAYER 0x2
-#define ENEMY 0x4
-#define BULLET 0x8
-#define COLLECTABLE 0x10
-#define WEAPON 0x20
-
-typedef struct {
-  byte flags;
-  byte health;
-  int x;
-  int y;
-  int dx;
-  int dy;
-} Entity;
-
-typedef struct {
-  int x;
-  int y;
-  int w;
-  int h;
-} Viewport;
-
-typedef struct {
-  SDL_Texture* tex;
-  int x;
-  int y;
-  int w;
-  int h;
-} Image;
-
-void play_level(SDL_Window* window, SDL_Renderer* renderer);
-void load(Entity players[], Entity enemies[], Entity bullets[], Entity collectables[], Entity weapons[]);
-void on_keydown(SDL_Event* evt, bool* is_gameover, bool* is_paused, SDL_Window* window);
-void update(double dt, unsigned int last_loop_time, unsigned int curr_time, Entity players[], Entity enemies[], Entity bullets[], Entity collectables[], Entity weapons[]);
-void render(SDL_Renderer* renderer, SDL_Texture* sprites, Entity players[], Entity enemies[], Entity bullets[], Entity collectables[], Entity weapons[], unsigned int start_time);
-
-// utility functions
-void toggle_fullscreen(SDL_Window *win);
-double calc_dist(int x1, int y1, int x2, int y2);
-int clamp(int val, int min, int max);
-int render_text(SDL_Renderer* renderer, char str[], int offset_x, int offset_y, int size);
-Image load_img(SDL_Renderer* renderer, char* path);
-void render_img(SDL_Renderer* renderer, Image* img);
-void center_img(Image* img, Viewport* viewport);
-void render_sprite(SDL_Renderer* renderer, SDL_Texture* sprites, int src_x, int src_y, int dest_x, int dest_y);
-void error(char* activity);
-
-// game globals
+#include "red-planet.h"
+#include "spatial_hash.h"
+#include "text.h"
+#include "pacer.h"
+#include "profiler.h"
+#include "map.h"
+#include "assets.h"
+#include "loader.h"
+#include "config.h"
+#include "jobs.h"
+#include "replay.h"
+#include "audio.h"
+#include "camera.h"
+#include "anim.h"
+#include "snapshot.h"
+#include "particles.h"
+#include "script.h"
+
+// game globals (most can be set in the config file, see config.c)
 Viewport vp = {};
 
+char start_screen[MAX_ASSET_PATH] = "example/title.png";
+SDL_Color start_screen_bg = {77, 49, 49, 255};
+char spritesheet[MAX_ASSET_PATH] = "example/spritesheet.png";
+
+// optional animation atlas (built with tools/atlas); entities without an
+// animation in it are drawn with the spritesheet
+char atlas_path[MAX_ASSET_PATH] = "";
+Atlas atlas = {};
+
 int bullet_w = 4;
 int bullet_h = 4;
 double bullet_speed = 1500.0; // in px/sec
 
 // px dimensions of sprites
-// TODO: read in from JSON
 int sprite_w = 32;
 int sprite_h = 32;
 
+double player_speed = 300.0; // in px/sec
+
+// the camera follows the players (see camera.h); vp is what it shows
+Camera camera = {};
+int camera_dead_zone_w = 200;
+int camera_dead_zone_h = 150;
+double camera_smoothing = 8.0; // per sec; 0 = no smoothing
+
 int max_players = 4;
 int max_enemies = 100;
 int max_bullets = 100;
 int max_collectables = 20;
 int max_weapons = 20;
 
-int level = 1;
+// hit & death effects (see particles.h); allocated at the max for each level
+int max_particles = 50000;
+Particles particles = {};
+SDL_Color impact_color = {255, 200, 90, 255};
+SDL_Color explosion_color = {255, 110, 40, 255};
+#define IMPACT_PARTICLES 6
+#define EXPLOSION_PARTICLES 40
+
+// optional Lua script for enemies (see script.h) & its budget per tick
+char script_path[MAX_ASSET_PATH] = "";
+int script_budget = 200000; // Lua instructions; 0 = no limit
 
 int header_height = 20;
 
-const int num_snd_effects = 6;
-Mix_Chunk *snd_effects[num_snd_effects];
+// mixer buffer in samples (its latency: 512 at 44.1 kHz is ~12 ms)
+int audio_buffer = 512;
 
 int game_width = 1024;
 int game_height = 768;
 
+// simulation runs at a fixed tick rate; rendering interpolates between ticks
+int tick_rate = 60; // in Hz
+int level_tick_rate = 60; // tick_rate as of the level's start (what the level runs at)
+int max_fps = 0; // 0 = display refresh rate
+bool vsync = true;
+
+char* profile_out = NULL; // frame profile dumped here on exit (.json = Chrome trace, else CSV)
+#define MAX_TICKS_PER_FRAME 8 // beyond this the sim slows down rather than spiraling
+
+// static screens (title, pause) wait for events instead of redrawing every frame;
+// they still wake this often to check the config (& the loader, while loading)
+#define IDLE_WAIT_MS 250
+#define LOADING_WAIT_MS 16
+
+char* config_path = "example/config.json";
+
+// where to log each level's inputs (--record), for --replay
+char* record_path = NULL;
+
+// F5 saves the level's state here & F9 restores it (see snapshot.h)
+Snapshot quick_save = {};
+
+// pre-decoded images (built with `make assets`); loose image files are used if it's missing
+char* pack_path = "example/assets.pak";
+
+// optional Tiled map drawn under the entities (its size becomes the game's size)
+char* map_path = NULL;
+Map map = {};
+
+// collision broad phase (rebuilt every tick in update())
+#define MAX_CANDIDATES 256
+int collision_cell_size = 64;
+SpatialHash enemy_hash = {};
+SpatialHash collectable_hash = {};
+SpatialHash weapon_hash = {};
+
+// update() runs its heavy phases on the job system, in chunks of this many entities
+#define UPDATE_CHUNK 2048
+int num_job_threads = -1; // -1 = one per core besides the main thread's, 0 = none
+float bullet_step = 0; // px each bullet moves this tick
+int* bullet_hits = NULL; // enemy each bullet hit this tick (-1 = none)
+int bullet_hits_cap = 0;
+
+// everything that lives for one level (the entity pools, bullet_hits); reset by unload()
+#define LEVEL_ARENA_BLOCK (4 * 1024 * 1024)
+Arena level_arena = {.block_size = LEVEL_ARENA_BLOCK};
+
+// every sprite drawn in a frame goes through this
+SpriteBatch sprite_batch = {};
+
+// HUD text
+CachedText level_text = {};
+CachedText player_text = {};
+CachedText time_text = {};
+
 // top level (title screen)
 int main(int num_args, char* args[]) {
+  if (num_args > 1 && strcmp(args[1], "--bench") == 0)
+    return run_bench(num_args - 2, args + 2);
+  if (num_args > 1 && strcmp(args[1], "--replay") == 0)
+    return run_replay(num_args - 2, args + 2);
+  if (num_args > 1 && strcmp(args[1], "--render-bench") == 0)
+    return run_render_bench(num_args - 2, args + 2);
+
+  // the config is read first so command line options override it
+  for (int i = 1; i + 1 < num_args; ++i)
+    if (strcmp(args[i], "--config") == 0)
+      config_path = args[i + 1];
+  if (!config_load(config_path))
+    printf("Not using a config file (can't read %s)\n", config_path);
+
+  for (int i = 1; i < num_args; ++i) {
+    bool has_val = i + 1 < num_args;
+    if (strcmp(args[i], "--tick-rate") == 0 && has_val)
+      tick_rate = clamp(atoi(args[++i]), 1, 1000);
+    else if (strcmp(args[i], "--max-fps") == 0 && has_val)
+      max_fps = atoi(args[++i]);
+    else if (strcmp(args[i], "--no-vsync") == 0)
+      vsync = false;
+    else if (strcmp(args[i], "--profile-out") == 0 && has_val)
+      profile_out = args[++i];
+    else if (strcmp(args[i], "--map") == 0 && has_val)
+      map_path = args[++i];
+    else if (strcmp(args[i], "--pack") == 0 && has_val)
+      pack_path = args[++i];
+    else if (strcmp(args[i], "--config") == 0 && has_val)
+      i++;
+    else if (strcmp(args[i], "--threads") == 0 && has_val)
+      num_job_threads = atoi(args[++i]);
+    else if (strcmp(args[i], "--record") == 0 && has_val)
+      record_path = args[++i];
+    else {
+      printf("usage: red-planet [--tick-rate HZ] [--max-fps N] [--no-vsync] [--profile-out trace.json|trace.csv] [--map level.tmx|level.json] [--pack assets.pak] [--config config.json] [--threads N] [--record session.rpl]\n");
+      printf("       red-planet --bench [--ticks N] [--hz N] [--seed N] [--sizes 100,1000,...] [--threads N]\n");
+      printf("       red-planet --replay session.rpl [--threads N]\n");
+      printf("       red-planet --render-bench [--frames N] [--size WxH] [--seed N] [--sizes 100,1000,...] [--capture-dir DIR] [--capture-every N] [--raw] [--profile-out trace.json|trace.csv]\n");
+      return 1;
+    }
+  }
+
   time_t seed = time(NULL); // 1529597895;
   srand(seed);
   printf("Seed: %lld\n", seed);
@@ -98,6 +188,7 @@ int main(int num_args, char* args[]) {
   // SDL setup
   if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0)
     error("initializing SDL");
+  jobs_init(num_job_threads);
 
   SDL_Window* window;
   window = SDL_CreateWindow("Red Planet Game", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, game_width, game_height, SDL_WINDOW_RESIZABLE);
@@ -108,94 +199,148 @@ int main(int num_args, char* args[]) {
   SDL_GetWindowSize(window, &vp.w, &vp.h);
   vp.h -= header_height;
 
-  SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+  SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | (vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
   if (!renderer)
     error("creating renderer");
 
   if (SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND) < 0)
     error("setting blend mode");
 
-  Image title_img = load_img(renderer, "example/title.png");
-  title_img.y = 50;
-  
-  if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0)
-    error("opening audio device");
+  if (!pack_open(pack_path))
+    printf("Not using asset pack (%s)\n", SDL_GetError());
 
-  // snd_effects[0] = Mix_LoadWAV("audio/tower_shoot.wav");
-  // snd_effects[1] = Mix_LoadWAV("audio/tower_damage.wav");
-  // snd_effects[2] = Mix_LoadWAV("audio/beast_damage.wav");
-  // snd_effects[3] = Mix_LoadWAV("audio/entity_enabled.wav");
-  // snd_effects[4] = Mix_LoadWAV("audio/tower_explosion.wav");
-  // snd_effects[5] = Mix_LoadWAV("audio/levelup.wav");
+  audio_init();
 
-  // for (int i = 0; i < num_snd_effects; ++i)
-  //   if (!snd_effects[i])
-  //     error("loading wav");
+  // everything is loaded in the background while the title screen runs
+  // (failures are reported by loader_poll() on this thread)
+  loader_init();
+  Image title_img = {.y = 50};
+  load_image_async(&title_img.tex, start_screen);
+  load_level_assets();
 
-  center_img(&title_img, &vp);
+  audio_load();
 
+  // the title screen only redraws when something on it changed, and sleeps
+  // in between until there's an event (or it's time to check the loader/config)
   SDL_Event evt;
   bool exit_game = false;
+  bool is_loaded = false;
+  bool start_level = false; // Enter pressed (the level starts once loading is done)
+  bool is_dirty = true;
   while (!exit_game) {
-    while (SDL_PollEvent(&evt)) {
-      if (evt.type == SDL_QUIT || (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_ESCAPE))
-        exit_game = true;
-      else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_RETURN)
-        play_level(window, renderer);
+    if (SDL_WaitEventTimeout(&evt, is_loaded ? IDLE_WAIT_MS : LOADING_WAIT_MS)) {
+      do {
+        if (evt.type == SDL_QUIT || (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_ESCAPE))
+          exit_game = true;
+        else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_RETURN)
+          start_level = true;
+        else if (evt.type == SDL_WINDOWEVENT && evt.window.event == SDL_WINDOWEVENT_RESIZED) {
+          SDL_GetWindowSize(window, &vp.w, &vp.h);
+          vp.h -= header_height;
+          center_img(&title_img, &vp);
+        }
+        is_dirty |= needs_redraw(&evt);
+      } while (SDL_PollEvent(&evt));
+    }
+    is_dirty |= config_poll();
+
+    if (!is_loaded) {
+      is_loaded = loader_poll(renderer);
+      is_dirty = true; // the progress bar
     }
+    if (title_img.tex && !title_img.w) {
+      SDL_QueryTexture(title_img.tex, NULL, NULL, &title_img.w, &title_img.h);
+      center_img(&title_img, &vp);
+    }
+
+    if (start_level && is_loaded) {
+      play_level(window, renderer);
+      start_level = false;
+      center_img(&title_img, &vp); // (in case the window was resized during the level)
+      is_dirty = true;
+    }
+
+    if (!is_dirty)
+      continue;
+    is_dirty = false;
 
     // set BG color
-    if (SDL_SetRenderDrawColor(renderer, 77, 49, 49, 255) < 0)
+    if (SDL_SetRenderDrawColor(renderer, start_screen_bg.r, start_screen_bg.g, start_screen_bg.b, start_screen_bg.a) < 0)
       error("setting bg color");
     if (SDL_RenderClear(renderer) < 0)
       error("clearing renderer");
-        
-    render_img(renderer, &title_img);
-    
+
+    if (title_img.tex)
+      render_img(renderer, &title_img);
+    if (!is_loaded)
+      render_progress(renderer, loader_progress());
+
     SDL_RenderPresent(renderer);
-    SDL_Delay(10);
   }
 
-  // for (int i = 0; i < num_snd_effects; ++i)
-  //   Mix_FreeChunk(snd_effects[i]);
-  Mix_Quit();
+  if (profile_out && !prof_dump(profile_out))
+    printf("writing profile to %s failed\n", profile_out);
 
   // if (SDL_SetWindowFullscreen(window, 0) < 0)
   //   error("exiting fullscreen");
 
-  SDL_DestroyTexture(title_img.tex);
-  
+  loader_quit();
+  audio_quit(); // (after the loader, which might still be loading a sound)
+  jobs_quit();
+  config_quit();
+  arena_free(&level_arena);
+  free_graphics();
+  pack_close();
+
   SDL_DestroyWindow(window);
   SDL_Quit();
   return 0;
 }
 
 void play_level(SDL_Window* window, SDL_Renderer* renderer) {
-  time_t seed = 1529597895; // 005; // time(NULL);
-  srand(seed);
-  printf("Seed: %lld\n", seed);
+  Uint32 seed = 1529597895; // 005; // time(NULL);
+  printf("Seed: %u\n", seed);
 
   // reset global variables
   unsigned int start_time = SDL_GetTicks();
   unsigned int pause_start = 0;
   
+  // the map (& everything else) was loaded on the title screen
+  if (map_path) {
+    game_width = map.w * map.tile_w;
+    game_height = map.h * map.tile_h;
+  }
+
   // load game
-  Entity players[max_players];
-  Entity enemies[max_enemies];
-  Entity bullets[max_bullets];
-  Entity collectables[max_collectables];
-  Entity weapons[max_weapons];
+  World world;
+  load(&world, seed);
+  camera_reset(&camera);
 
-  load(players, enemies, bullets, collectables, weapons);
+  // the log can't capture config changes, so they're held until the level ends
+  if (record_path && !record_start(record_path, seed))
+    printf("Not recording (%s)\n", SDL_GetError());
+  else if (record_path)
+    config_hold(true);
 
-  SDL_Texture* sprites = IMG_LoadTexture(renderer, "example/spritesheet.png");
+  SDL_Texture* sprites = load_texture(renderer, spritesheet);
   if (!sprites)
     error("loading image");
 
   // game loop (incl. events, update & draw)
+  // the sim advances in fixed ticks of 1/level_tick_rate sec, paid for out of
+  // real (performance counter) time; whatever's left over is the interpolation
+  // alpha. (A tick_rate changed mid-level applies from the next level)
+  Uint64 freq = SDL_GetPerformanceFrequency();
+  Uint64 tick_len = freq / level_tick_rate;
+  Uint64 accumulator = 0;
+  Uint64 tick = 0;
+  FramePacer pacer;
+  pacer_init(&pacer, window, renderer, max_fps);
+
   bool is_gameover = false;
   bool is_paused = false;
-  unsigned int last_loop_time = SDL_GetTicks();
+  double alpha = 0;
+  Uint64 last_loop_time = SDL_GetPerformanceCounter();
   while (!is_gameover) {
     SDL_Event evt;
 
@@ -203,30 +348,63 @@ void play_level(SDL_Window* window, SDL_Renderer* renderer) {
     if (is_paused) {
       if (!pause_start)
         pause_start = SDL_GetTicks();
-      while (SDL_PollEvent(&evt))
-        if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_SPACE)
-          is_paused = false;
+      // nothing moves while paused, so the last frame stays up until an event
+      // (or a config change) needs it redrawn
+      bool is_dirty = false;
+      if (SDL_WaitEventTimeout(&evt, IDLE_WAIT_MS)) {
+        do {
+          if (evt.type == SDL_QUIT)
+            is_gameover = true;
+          else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_SPACE)
+            is_paused = false;
+          else if (evt.type == SDL_KEYUP)
+            on_key_input(&evt, tick, &world); // so keys released while paused don't stay held
+          else if (evt.type == SDL_WINDOWEVENT && evt.window.event == SDL_WINDOWEVENT_RESIZED) {
+            SDL_GetWindowSize(window, &vp.w, &vp.h);
+            vp.h -= header_height;
+          }
+          else if (evt.type == SDL_RENDER_TARGETS_RESET)
+            invalidate_render_targets();
+          is_dirty |= needs_redraw(&evt);
+        } while (SDL_PollEvent(&evt));
+      }
+      is_dirty |= config_poll();
 
+      if (is_gameover)
+        break;
       if (is_paused) {
-        SDL_Delay(10);
+        // (with the clock stopped at the pause; the camera only re-clamps to the new size)
+        if (is_dirty) {
+          camera_update(&camera, &vp, &world.players, alpha, 0);
+          render(renderer, sprites, &world, alpha, pause_start - start_time);
+        }
         continue;
       }
       else {
         // reset last_loop_time when coming out of a pause state
         // otherwise the game will react as if a ton of time has gone by
-        last_loop_time = SDL_GetTicks();
+        last_loop_time = SDL_GetPerformanceCounter();
+        pacer_reset(&pacer);
 
         // add elapsed pause time to start time, otherwise the pause time is added to the clock
-        start_time += last_loop_time - pause_start;
+        start_time += SDL_GetTicks() - pause_start;
         pause_start = 0;
       }
     }
 
+    prof_begin_frame();
+
     // manage delta time
-    unsigned int curr_time = SDL_GetTicks();
-    double dt = (curr_time - last_loop_time) / 1000.0; // dt should always be in seconds
+    Uint64 curr_time = SDL_GetPerformanceCounter();
+    double frame_dt = (double)(curr_time - last_loop_time) / freq;
+    accumulator += curr_time - last_loop_time;
+    if (accumulator > tick_len * MAX_TICKS_PER_FRAME)
+      accumulator = tick_len * MAX_TICKS_PER_FRAME;
+    last_loop_time = curr_time;
 
-    // handle events
+    // handle events (incl. config changes)
+    prof_begin(PHASE_EVENTS);
+    config_poll();
     while (SDL_PollEvent(&evt)) {
       switch(evt.type) {
         case SDL_QUIT:
@@ -238,38 +416,86 @@ void play_level(SDL_Window* window, SDL_Renderer* renderer) {
             vp.h -= header_height;
           }
           break;
+        case SDL_RENDER_TARGETS_RESET:
+          invalidate_render_targets();
+          break;
         case SDL_KEYDOWN:
+          on_key_input(&evt, tick, &world);
           on_keydown(&evt, &is_gameover, &is_paused, window);
+          if (!evt.key.repeat)
+            on_save_key(evt.key.keysym.sym, tick, &world);
+          break;
+        case SDL_KEYUP:
+          on_key_input(&evt, tick, &world);
           break;
       }
     }
+    prof_end(PHASE_EVENTS);
+
+    // fixed-dt ticks; the times passed to update() are simulated ms, not wall-clock
+    while (accumulator >= tick_len) {
+      unsigned int tick_start = tick * 1000 / level_tick_rate;
+      unsigned int tick_end = (tick + 1) * 1000 / level_tick_rate;
+      prof_begin(PHASE_UPDATE);
+      update(1.0 / level_tick_rate, tick_start, tick_end, &world);
+      prof_end(PHASE_UPDATE);
+      accumulator -= tick_len;
+      tick++;
+    }
 
-    update(dt, last_loop_time, curr_time, players, enemies, bullets, collectables, weapons);
-    render(renderer, sprites, players, enemies, bullets, collectables, weapons, start_time);
+    // the sounds this frame's ticks asked for
+    audio_update();
 
-    SDL_Delay(10);
-    last_loop_time = curr_time;
+    alpha = (double)accumulator / tick_len;
+    camera_update(&camera, &vp, &world.players, alpha, frame_dt);
+    render(renderer, sprites, &world, alpha, SDL_GetTicks() - start_time);
+
+    prof_begin(PHASE_SLEEP);
+    pacer_wait(&pacer);
+    prof_end(PHASE_SLEEP);
+    prof_end_frame();
   }
 
-  SDL_DestroyTexture(sprites);
+  record_end(tick, &world);
+  config_hold(false);
+  snapshot_free(&quick_save);
+  unload(&world);
 }
 
-void load(Entity players[], Entity enemies[], Entity bullets[], Entity collectables[], Entity weapons[]) {
-  // precreate all entities as deleted
-  for (int i = 0; i < max_players; ++i)
-    players[i].flags = PLAYER | DELETED;
-
-  for (int i = 0; i < max_enemies; ++i)
-    enemies[i].flags = ENEMY | DELETED;
-
-  for (int i = 0; i < max_bullets; ++i)
-    bullets[i].flags = BULLET | DELETED;
-
-  for (int i = 0; i < max_collectables; ++i)
-    collectables[i].flags = COLLECTABLE | DELETED;
+void load(World* world, Uint32 seed) {
+  // the pools start small & grow (up to the max_* limits) as entities spawn
+  pool_init(&world->players, &level_arena, PLAYER, max_players);
+  pool_init(&world->enemies, &level_arena, ENEMY, max_enemies);
+  pool_init(&world->bullets, &level_arena, BULLET, max_bullets);
+  pool_init(&world->collectables, &level_arena, COLLECTABLE, max_collectables);
+  pool_init(&world->weapons, &level_arena, WEAPON, max_weapons);
+
+  particles_init(&particles, &level_arena, max_particles);
+
+  bullet_hits = NULL;
+  bullet_hits_cap = 0;
+  level_tick_rate = tick_rate;
+  world->buttons = 0;
+  world->rng = seed ? seed : 1; // (xorshift never leaves 0)
+  world->level = 1;
+
+  // each kind of entity plays the atlas animation named after it (if there is one)
+  world->players.start_anim = atlas_find_anim(&atlas, "player");
+  world->enemies.start_anim = atlas_find_anim(&atlas, "enemy");
+  world->bullets.start_anim = atlas_find_anim(&atlas, "bullet");
+  world->collectables.start_anim = atlas_find_anim(&atlas, "collectable");
+  world->weapons.start_anim = atlas_find_anim(&atlas, "weapon");
+
+  // player 1 starts in the middle of the world
+  int p = pool_spawn(&world->players);
+  if (p != -1) {
+    world->players.x[p] = (game_width - sprite_w) / 2;
+    world->players.y[p] = (game_height - sprite_h) / 2;
+    world->players.health[p] = 3;
+  }
 
-  for (int i = 0; i < max_weapons; ++i)
-    weapons[i].flags = WEAPON | DELETED;
+  // the script places the rest
+  script_start(world);
 }
 
 void on_keydown(SDL_Event* evt, bool* is_gameover, bool* is_paused, SDL_Window* window) {
@@ -283,22 +509,102 @@ void on_keydown(SDL_Event* evt, bool* is_gameover, bool* is_paused, SDL_Window*
     case SDLK_SPACE:
       *is_paused = !*is_paused;
       break;
-    // case SDLK_LEFT:
-    //   scroll_to(vp.x - 20, vp.y);
-    //   break;
-    // case SDLK_RIGHT:
-    //   scroll_to(vp.x + 20, vp.y);
-    //   break;
-    // case SDLK_UP:
-    //   scroll_to(vp.x, vp.y - 20);
-    //   break;
-    // case SDLK_DOWN:
-    //   scroll_to(vp.x, vp.y + 20);
-    //   break;
+    case SDLK_F3:
+      prof_toggle_overlay();
+      break;
+  }
+}
+
+// applies (& logs) a key press/release that the simulation sees, as of the next tick
+void on_key_input(SDL_Event* evt, Uint32 tick, World* world) {
+  if (evt->key.repeat)
+    return;
+
+  InputEvent input = {
+    .tick = tick,
+    .code = evt->key.keysym.sym,
+    .type = evt->type == SDL_KEYDOWN ? INPUT_KEY_DOWN : INPUT_KEY_UP
+  };
+  apply_input(&input, world);
+  record_input(&input);
+}
+
+// the only way input reaches the simulation, so replaying the same inputs at
+// the same ticks reproduces a session exactly
+void apply_input(InputEvent* input, World* world) {
+  Uint32 button = 0;
+  switch (input->code) {
+    case SDLK_LEFT: case SDLK_a: button = BUTTON_LEFT; break;
+    case SDLK_RIGHT: case SDLK_d: button = BUTTON_RIGHT; break;
+    case SDLK_UP: case SDLK_w: button = BUTTON_UP; break;
+    case SDLK_DOWN: case SDLK_s: button = BUTTON_DOWN; break;
+  }
+
+  if (input->type == INPUT_KEY_DOWN)
+    world->buttons |= button;
+  else
+    world->buttons &= ~button;
+}
+
+// F5: quick save, F9: quick load (the level's state only; the clock keeps going)
+void on_save_key(SDL_Keycode key, Uint32 tick, World* world) {
+  if (key == SDLK_F5) {
+    snapshot_take(&quick_save, world);
+    printf("Saved (%u KB)\n", (unsigned int)(quick_save.len / 1024));
+  }
+  else if (key == SDLK_F9 && quick_save.len) {
+    // what follows a load can't be reproduced from the inputs alone, so the
+    // input log ends here (with the world as it was before the load)
+    record_end(tick, world);
+    if (!snapshot_restore(&quick_save, world)) {
+      printf("Can't load the save (%s)\n", SDL_GetError());
+      return;
+    }
+    camera_reset(&camera); // (jump to the players rather than pan)
   }
 }
 
-void update(double dt, unsigned int last_loop_time, unsigned int curr_time, Entity players[], Entity enemies[], Entity bullets[], Entity collectables[], Entity weapons[]) {
+void update(double dt, unsigned int last_loop_time, unsigned int curr_time, World* world) {
+  Pool* players = &world->players;
+  Pool* enemies = &world->enemies;
+  Pool* bullets = &world->bullets;
+  Pool* collectables = &world->collectables;
+  Pool* weapons = &world->weapons;
+
+  // remember where everything was, for render interpolation
+  pool_save_positions(players);
+  pool_save_positions(enemies);
+  pool_save_positions(bullets);
+  pool_save_positions(collectables);
+  pool_save_positions(weapons);
+
+  // players move with the held buttons, at the same speed diagonally
+  // (there's one keyboard, so every player follows it)
+  float move_x = ((world->buttons & BUTTON_RIGHT) != 0) - ((world->buttons & BUTTON_LEFT) != 0);
+  float move_y = ((world->buttons & BUTTON_DOWN) != 0) - ((world->buttons & BUTTON_UP) != 0);
+  if (move_x && move_y) {
+    move_x *= 0.70710678f; // 1/sqrt(2)
+    move_y *= 0.70710678f;
+  }
+  float step = player_speed * dt;
+  for (int i = 0; i < players->count; ++i) {
+    players->x[i] = fminf(fmaxf(players->x[i] + move_x * step, 0), game_width - sprite_w);
+    players->y[i] = fminf(fmaxf(players->y[i] + move_y * step, 0), game_height - sprite_h);
+  }
+
+  // scripted enemies (before the collision hashes are built, so hits see
+  // where the scripts moved them)
+  script_update(world, dt);
+
+  // animations
+  float dt_ms = dt * 1000;
+  anim_advance(&atlas, players, dt_ms);
+  anim_advance(&atlas, enemies, dt_ms);
+  anim_advance(&atlas, bullets, dt_ms);
+  anim_advance(&atlas, collectables, dt_ms);
+  anim_advance(&atlas, weapons, dt_ms);
+  particles_update(&particles, dt);
+
   // fortress firing
   // for (int i = 0; i < max_buildings; ++i) {
   //   Entity* turret = &buildings[i];
@@ -347,130 +653,227 @@ void update(double dt, unsigned int last_loop_time, unsigned int curr_time, Enti
   //   if (dist > fortress_attack_dist)
   //     continue;
 
-  //   Mix_PlayChannel(-1, snd_effects[0], 0);
+  //   play_sound(SND_TOWER_SHOOT);
 
   //   // dividing by the distance gives us a normalized 1-unit vector
   //   double dx = (enemy->x - turret->x) / dist;
   //   double dy = (enemy->y - turret->y) / dist;
-  //   for (int j = 0; j < max_bullets; ++j) {
-  //     Bullet* b = &bullets[j];
-  //     if (b->flags & DELETED) {
-  //       b->flags &= (~DELETED); // clear the DELETED bit
-        
-  //       // start in top/left corner
-  //       int start_x = turret->x * block_w;
-  //       int start_y = turret->y * block_h;
-  //       if (dx > 0)
-  //         start_x += block_w;
-  //       else if (dx == 0)
-  //         start_x += block_w / 2;
-  //       else
-  //         start_x -= 1; // so it's not on top of itself
-
-  //       if (dy > 0)
-  //         start_y += block_h;
-  //       else if (dy == 0)
-  //         start_y += block_h / 2;
-  //       else
-  //         start_y -= 1; // so it's not on top of itself
-
-  //       b->x = start_x;
-  //       b->y = start_y;
-  //       b->dx = dx;
-  //       b->dy = dy;
-  //       break;
-  //     }
-  //   }
+  //   int b = pool_spawn(bullets);
+  //   if (b == -1)
+  //     continue;
+
+  //   // start in top/left corner
+  //   int start_x = turret->x * block_w;
+  //   int start_y = turret->y * block_h;
+  //   if (dx > 0)
+  //     start_x += block_w;
+  //   else if (dx == 0)
+  //     start_x += block_w / 2;
+  //   else
+  //     start_x -= 1; // so it's not on top of itself
+
+  //   if (dy > 0)
+  //     start_y += block_h;
+  //   else if (dy == 0)
+  //     start_y += block_h / 2;
+  //   else
+  //     start_y -= 1; // so it's not on top of itself
+
+  //   bullets->x[b] = start_x;
+  //   bullets->y[b] = start_y;
+  //   bullets->dx[b] = dx;
+  //   bullets->dy[b] = dy;
   // }
 
-  // update bullet positions; handle bullet collisions
-  for (int i = 0; i < max_bullets; ++i) {
-    if (bullets[i].flags & DELETED)
+  // bullet_hits follows the bullet pool's growth (the arena isn't thread safe,
+  // so this happens before any jobs are queued)
+  if (bullet_hits_cap < bullets->cap) {
+    bullet_hits = arena_alloc(&level_arena, bullets->cap * sizeof(int));
+    bullet_hits_cap = bullets->cap;
+  }
+
+  // phases (spread over all cores by the job system):
+  //   rebuild collision hashes ─┐
+  //   move bullets ─────────────┴─> cull bullets & find their hits ─> apply damage (serial)
+  JobCounter hashed = {};
+  JobCounter moved = {};
+  JobCounter hit = {};
+  jobs_run(&hashed, NULL, build_hash_job, world, 3, 1);
+  bullet_step = bullet_speed * dt;
+  jobs_run(&moved, NULL, move_bullets_job, world, bullets->count, UPDATE_CHUNK);
+  jobs_wait(&hashed);
+  jobs_run(&hit, &moved, hit_bullets_job, world, bullets->count, UPDATE_CHUNK);
+  jobs_wait(&hit);
+
+  // damage is applied in bullet order, so the outcome is the same however the
+  // work was split up
+  for (int i = 0; i < bullets->count; ++i) {
+    int e = bullet_hits[i];
+    if (e < 0)
       continue;
 
-    bullets[i].x += bullets[i].dx * bullet_speed * dt;
-    bullets[i].y += bullets[i].dy * bullet_speed * dt;
-    // delete bullets that have gone out of the game
-    if ((bullets[i].x < 0 || bullets[i].x > game_width) ||
-      bullets[i].y < 0 || bullets[i].y > game_height) {
-        bullets[i].flags |= DELETED; // set deleted bit on
-        continue;
+    // if an earlier bullet killed it this tick, look again (skipping it)
+    if (enemies->flags[e] & DELETED)
+      e = find_bullet_hit(bullets, i, enemies);
+    if (e < 0)
+      continue;
+
+    inflict_damage(enemies, e);
+    bullets->flags[i] |= DELETED;
+    particles_burst(&particles, bullets->x[i], bullets->y[i], IMPACT_PARTICLES, 150, 0.25f, 2, impact_color);
+    if (enemies->flags[e] & DELETED)
+      particles_burst(&particles, enemies->x[e] + sprite_w / 2, enemies->y[e] + sprite_h / 2, EXPLOSION_PARTICLES, 320, 0.6f, 4, explosion_color);
+    play_sound(SND_BEAST_DAMAGE); // (merged into one play per frame, however many hit)
+  }
+
+  int candidates[MAX_CANDIDATES];
+
+  // player -> collectable & weapon pickups
+  for (int i = 0; i < players->count; ++i) {
+    if (players->flags[i] & DELETED)
+      continue;
+
+    float x = players->x[i];
+    float y = players->y[i];
+    int num = spatial_hash_query(&collectable_hash, x, y, sprite_w, sprite_h, candidates, MAX_CANDIDATES);
+    for (int c = 0; c < num; ++c) {
+      int e = candidates[c];
+      if (!(collectables->flags[e] & DELETED) && overlaps(x, y, sprite_w, sprite_h, collectables->x[e], collectables->y[e], sprite_w, sprite_h))
+        collectables->flags[e] |= DELETED;
     }
 
-    // int grid_x = bullets[i].x / block_w;
-    // int grid_y = bullets[i].y / block_h;
-    // if (is_in_grid(grid_x, grid_y)) {
-    //   int pos = to_pos(grid_x, grid_y);
-    //   Entity* ent = grid[pos];
-    //   if (ent && ent->flags & TURRET) {
-    //     bullets[i].flags |= DELETED;
-    //     continue;
-    //   }
-    //   else if (ent && ent->flags & ENEMY) {
-    //     inflict_damage(ent, grid);
-    //     bullets[i].flags |= DELETED;
-    //     if (ent->flags & DELETED && !countLiveEntities(nests, max_nests)) {
-    //       Mix_PlayChannel(-1, snd_effects[5], 0);
-    //       level++;
-    //       if (level <= 4)
-    //         create_nests(level, start_pos, nests, grid, grid_flags);
-    //     }
-    //     else {
-    //       Mix_PlayChannel(-1, snd_effects[2], 0);
-    //     }
-    //   }
-    // }
+    num = spatial_hash_query(&weapon_hash, x, y, sprite_w, sprite_h, candidates, MAX_CANDIDATES);
+    for (int c = 0; c < num; ++c) {
+      int e = candidates[c];
+      if (!(weapons->flags[e] & DELETED) && overlaps(x, y, sprite_w, sprite_h, weapons->x[e], weapons->y[e], sprite_w, sprite_h))
+        weapons->flags[e] |= DELETED;
+    }
+  }
+
+  // compact away everything that died this tick (nothing holds slot indices past this point)
+  pool_sweep(players);
+  pool_sweep(enemies);
+  pool_sweep(bullets);
+  pool_sweep(collectables);
+  pool_sweep(weapons);
+}
+
+// frees the entity pools & per-level collision state
+void unload(World* world) {
+  script_stop();
+  arena_reset(&level_arena);
+  *world = (World){};
+  particles = (Particles){};
+  bullet_hits = NULL;
+  bullet_hits_cap = 0;
+
+  // (the hashes are built on job threads, so they're malloc'd rather than in the arena)
+  spatial_hash_free(&enemy_hash);
+  spatial_hash_free(&collectable_hash);
+  spatial_hash_free(&weapon_hash);
+}
+
+// update jobs
+
+// builds one of the 3 collision hashes per item
+void build_hash_job(void* data, int begin, int end) {
+  World* world = data;
+  for (int i = begin; i < end; ++i) {
+    if (i == 0)
+      spatial_hash_build(&enemy_hash, collision_cell_size, &world->enemies, sprite_w, sprite_h);
+    else if (i == 1)
+      spatial_hash_build(&collectable_hash, collision_cell_size, &world->collectables, sprite_w, sprite_h);
+    else
+      spatial_hash_build(&weapon_hash, collision_cell_size, &world->weapons, sprite_w, sprite_h);
+  }
+}
+
+// moves a range of bullets (vectorized)
+void move_bullets_job(void* data, int begin, int end) {
+  Pool* bullets = &((World*)data)->bullets;
+  integrate(bullets->x + begin, bullets->y + begin, bullets->dx + begin, bullets->dy + begin, end - begin, bullet_step);
+}
+
+// records the enemy each bullet in a range hit & culls the rest that left the
+// game; enemies aren't touched here, so ranges can run in parallel
+void hit_bullets_job(void* data, int begin, int end) {
+  World* world = data;
+  Pool* bullets = &world->bullets;
+  for (int i = begin; i < end; ++i) {
+    bullet_hits[i] = -1;
+    if (bullets->flags[i] & DELETED)
+      continue;
+
+    // (a bullet that hits something on its way out of the game still hits it)
+    bullet_hits[i] = find_bullet_hit(bullets, i, &world->enemies);
+    if (bullet_hits[i] != -1)
+      continue;
+
+    // delete bullets that have gone out of the game
+    float x = bullets->x[i];
+    float y = bullets->y[i];
+    if ((x < 0 || x > game_width) || y < 0 || y > game_height)
+      bullets->flags[i] |= DELETED; // set deleted bit on
+  }
+}
+
+// the first live enemy bullet i hits on its way through this tick (-1 if none)
+int find_bullet_hit(Pool* bullets, int i, Pool* enemies) {
+  // a bullet moves bullet_speed / tick_rate px a tick (25 at the defaults),
+  // enough to skip past an enemy's corner, or at lower tick rates the whole
+  // enemy, so its whole move is tested, from where it was at the start of the
+  // tick. (One spawned during the tick has no start position; where it is counts)
+  float x0 = bullets->prev_x[i];
+  float y0 = bullets->prev_y[i];
+  if (bullets->flags[i] & SPAWNED) {
+    x0 = bullets->x[i];
+    y0 = bullets->y[i];
   }
+
+  float t;
+  return spatial_hash_sweep(&enemy_hash, enemies, sprite_w, sprite_h, x0, y0, bullets->x[i], bullets->y[i], bullet_w, bullet_h, &t);
 }
 
-void render(SDL_Renderer* renderer, SDL_Texture* sprites, Entity players[], Entity enemies[], Entity bullets[], Entity collectables[], Entity weapons[], unsigned int start_time) {
+// alpha is how far (0-1) we are between the last tick & the next one; elapsed
+// is the level's play time in ms, for the clock
+void render(SDL_Renderer* renderer, SDL_Texture* sprites, World* world, double alpha, unsigned int elapsed) {
+  prof_begin(PHASE_RENDER_WORLD);
+
   // set BG color
   if (SDL_SetRenderDrawColor(renderer, 77, 49, 49, 255) < 0)
     error("setting bg color");
   if (SDL_RenderClear(renderer) < 0)
     error("clearing renderer");
 
-  // render players
-  for (int i = 0; i < max_players; ++i) {
-    if (players[i].flags & DELETED)
-      continue;
+  // static tile layers (pre-baked chunks)
+  map_render(&map, renderer, &vp);
 
-    render_sprite(renderer, sprites, 1,3, players[i].x, players[i].y);
-  }
+  // all sprites are queued into one batch & submitted together
+  batch_begin(&sprite_batch, renderer);
 
-  // render enemies
-  for (int i = 0; i < max_enemies; ++i) {
-    if (enemies[i].flags & DELETED)
-      continue;
+  // render players
+  render_pool(&sprite_batch, sprites, &world->players, alpha);
 
-    render_sprite(renderer, sprites, 1,3, enemies[i].x, enemies[i].y);
-  }
+  // render enemies
+  render_pool(&sprite_batch, sprites, &world->enemies, alpha);
 
   // render bullets
-  for (int i = 0; i < max_bullets; ++i) {
-    if (bullets[i].flags & DELETED)
-      continue;
-
-    render_sprite(renderer, sprites, 1,3, bullets[i].x, bullets[i].y);
-  }
+  render_pool(&sprite_batch, sprites, &world->bullets, alpha);
 
   // render collectables
-  for (int i = 0; i < max_collectables; ++i) {
-    if (collectables[i].flags & DELETED)
-      continue;
-
-    render_sprite(renderer, sprites, 1,3, collectables[i].x, collectables[i].y);
-  }
+  render_pool(&sprite_batch, sprites, &world->collectables, alpha);
 
   // render weapons
-  for (int i = 0; i < max_players; ++i) {
-    if (weapons[i].flags & DELETED)
-      continue;
+  render_pool(&sprite_batch, sprites, &world->weapons, alpha);
 
-    render_sprite(renderer, sprites, 1,3, weapons[i].x, weapons[i].y);
-  }
+  // effects, over everything
+  particles_render(&particles, &sprite_batch, &vp, (1 - alpha) / level_tick_rate);
+
+  batch_flush(&sprite_batch);
+  prof_end(PHASE_RENDER_WORLD);
 
   // header
+  prof_begin(PHASE_RENDER_HUD);
   int text_px_size = 2;
   if (SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255) < 0)
     error("setting header color");
@@ -486,48 +889,59 @@ void render(SDL_Renderer* renderer, SDL_Texture* sprites, Entity players[], Enti
   if (SDL_SetRenderDrawColor(renderer, 120, 120, 120, 255) < 0)
     error("setting text color");
 
-  char level_str[10];
-  snprintf(level_str, sizeof(level_str), "Level: %d", level);
-  render_text(renderer, level_str, 5, 10, 1);
+  // HUD strings are cached as textures & only re-rendered when they change
+  char level_str[16];
+  snprintf(level_str, sizeof(level_str), "Level: %d", world->level);
+  render_cached_text(renderer, &level_text, level_str, 5, 10, 1);
 
-  char player_str[10];
+  char player_str[16];
   snprintf(player_str, sizeof(player_str), "Player 1: %d", 4);
-  render_text(renderer, player_str, 35, 20, 1);
+  render_cached_text(renderer, &player_text, player_str, 35, 20, 1);
 
-  unsigned int elapsed = SDL_GetTicks() - start_time;
   int sec = (int)(elapsed / 1000.0);
   int min = sec / 60;
   sec -= min * 60;
   char time_str[9]; // 9 digits goes up to -99999:59
   snprintf(time_str, sizeof(time_str), "%d:%02d", min, sec);
-  render_text(renderer, time_str, vp.w - 80, 5, 2);
+  render_cached_text(renderer, &time_text, time_str, vp.w - 80, 5, 2);
+
+  // frame-time graph (between the player label & the timer) & per-phase table
+  prof_render_overlay(renderer, 160, 1, vp.w - 80 - 10 - 160, header_height - 2);
+  prof_end(PHASE_RENDER_HUD);
 
+  prof_begin(PHASE_PRESENT);
   SDL_RenderPresent(renderer);
+  prof_end(PHASE_PRESENT);
 }
 
 
 // Game-Specific Functions
-Entity* closest_entity(int x, int y, Entity entities[], int num_entities) {
-  Entity* winner = NULL;
-  double winner_dist = -1;
-  
-  for (int i = 0; i < num_entities; ++i) {
-    if (entities[i].flags & DELETED)
+// returns the index of the live entity in the pool closest to x/y, or -1 if there are none
+// (a linear scan: for many queries a tick, use spatial_hash_nearest() on a hash of the pool)
+int closest_entity(float x, float y, Pool* pool) {
+  int winner = -1;
+  float winner_dist_sq = INFINITY;
+
+  for (int i = 0; i < pool->count; ++i) {
+    if (pool->flags[i] & DELETED)
       continue;
 
-    double dist = calc_dist(x, y, entities[i].x, entities[i].y);
-    if (winner_dist == -1 || dist < winner_dist) {
-      winner = &entities[i];
-      winner_dist = dist;
+    // squared distances compare the same as distances, without the sqrt
+    float dx = pool->x[i] - x;
+    float dy = pool->y[i] - y;
+    float dist_sq = dx * dx + dy * dy;
+    if (dist_sq < winner_dist_sq) {
+      winner = i;
+      winner_dist_sq = dist_sq;
     }
   }
   return winner;
 }
 
-void inflict_damage(Entity* ent, Entity* grid[]) {
-  ent->health--;
-  if (ent->health <= 0)
-    ent->flags |= DELETED; // flip DELETED bit on
+void inflict_damage(Pool* pool, int i) {
+  pool->health[i]--;
+  if (pool->health[i] <= 0)
+    pool->flags[i] |= DELETED; // flip DELETED bit on
 }
 
 
@@ -544,8 +958,20 @@ void toggle_fullscreen(SDL_Window *win) {
     error("Toggling fullscreen mode failed");
 }
 
-double calc_dist(int x1, int y1, int x2, int y2) {
-  return sqrt(pow(x1 - x2, 2) + pow(y1 - y2, 2));
+// xorshift32: the simulation's randomness, kept in the world so that snapshots
+// & replays capture it
+Uint32 world_rand(World* world) {
+  Uint32 x = world->rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return world->rng = x;
+}
+
+double calc_dist(float x1, float y1, float x2, float y2) {
+  double dx = x1 - x2;
+  double dy = y1 - y2;
+  return sqrt(dx * dx + dy * dy);
 }
 
 int clamp(int val, int min, int max) {
@@ -557,35 +983,69 @@ int clamp(int val, int min, int max) {
     return val;
 }
 
-int render_text(SDL_Renderer* renderer, char str[], int offset_x, int offset_y, int size) {
-  int i;
-  for (i = 0; str[i] != '\0'; ++i) {
-    int code = str[i];
-    if (code < 0 || code > 127)
-      error("Text code out of range");
-
-    char* bitmap = font8x8_basic[code];
-    int set = 0;
-    for (int y = 0; y < 8; ++y) {
-      for (int x = 0; x < 8; ++x) {
-        set = bitmap[y] & 1 << x;
-        if (!set)
-          continue;
-
-        SDL_Rect r = {
-          .x = offset_x + i * (size) * 8 + x * size,
-          .y = offset_y + y * size,
-          .w = size,
-          .h = size
-        };
-        if (SDL_RenderFillRect(renderer, &r) < 0)
-          error("drawing text block");
-      }
-    }
-  }
+// queues what levels draw with (the spritesheet, map & atlas) on the loader
+void load_level_assets() {
+  load_image_async(NULL, spritesheet);
+  if (map_path)
+    load_task_async(load_map, load_map_textures, &map);
+  if (atlas_path[0])
+    load_task_async(load_atlas, load_atlas_texture, &atlas);
+}
+
+// baked map chunks & cached text are render targets, so their contents are
+// gone when the renderer resets them; they're redrawn the next time they're used
+void invalidate_render_targets() {
+  map_invalidate(&map);
+  text_invalidate(&level_text);
+  text_invalidate(&player_text);
+  text_invalidate(&time_text);
+}
+
+// frees everything made for the renderer (textures, baked map chunks, text & batch buffers)
+void free_graphics() {
+  map_free(&map);
+  free_textures();
+  free_cached_text(&level_text);
+  free_cached_text(&player_text);
+  free_cached_text(&time_text);
+  free_glyph_atlas();
+  batch_free(&sprite_batch);
+}
+
+// loader task: parses the map on a loader thread...
+bool load_map(void* data) {
+  return map_load(data, map_path);
+}
+
+// ...then queues its tileset images
+void load_map_textures(void* data) {
+  Map* loaded_map = data;
+  for (int t = 0; t < loaded_map->num_tilesets; ++t)
+    load_image_async(&loaded_map->tilesets[t].tex, loaded_map->tilesets[t].image);
+}
 
-  // width of total text string
-  return i * size * 8;
+// reads the atlas metadata (on a loader thread)...
+bool load_atlas(void* data) {
+  return atlas_load(data, atlas_path);
+}
+
+// ...then queues its image
+void load_atlas_texture(void* data) {
+  Atlas* loaded_atlas = data;
+  load_image_async(&loaded_atlas->tex, loaded_atlas->image);
+}
+
+// "Loading" & a bar at the bottom of the window
+void render_progress(SDL_Renderer* renderer, float progress) {
+  int bar_w = 200;
+  SDL_Rect bar = {.x = vp.w / 2 - bar_w / 2, .y = vp.h - 20, .w = bar_w, .h = 8};
+  SDL_Rect filled = {.x = bar.x, .y = bar.y, .w = bar_w * progress, .h = bar.h};
+
+  if (SDL_SetRenderDrawColor(renderer, 200, 200, 200, 255) < 0)
+    error("setting progress color");
+  render_text(renderer, "Loading", bar.x, bar.y - 12, 1);
+  if (SDL_RenderDrawRect(renderer, &bar) < 0 || SDL_RenderFillRect(renderer, &filled) < 0)
+    error("drawing progress bar");
 }
 
 // it may be more efficient to load the image into an sdl image
@@ -593,7 +1053,7 @@ int render_text(SDL_Renderer* renderer, char str[], int offset_x, int offset_y,
 // instead of loading it directly to a texture & then querying the texture?
 Image load_img(SDL_Renderer* renderer, char* path) {
   Image img = {};
-  img.tex = IMG_LoadTexture(renderer, path);
+  img.tex = load_texture(renderer, path);
   if (!img.tex)
     error("loading image");
 
@@ -607,16 +1067,66 @@ void render_img(SDL_Renderer* renderer, Image* img) {
     error("renderCopy");
 }
 
+// whether the event means whatever's on screen has to be drawn again
+bool needs_redraw(SDL_Event* evt) {
+  if (evt->type == SDL_RENDER_TARGETS_RESET || evt->type == SDL_RENDER_DEVICE_RESET)
+    return true;
+  if (evt->type != SDL_WINDOWEVENT)
+    return false;
+
+  switch (evt->window.event) {
+    case SDL_WINDOWEVENT_EXPOSED:
+    case SDL_WINDOWEVENT_SIZE_CHANGED:
+    case SDL_WINDOWEVENT_RESTORED:
+    case SDL_WINDOWEVENT_SHOWN:
+      return true;
+  }
+  return false;
+}
+
 // centers the image horizontally in the viewport
 void center_img(Image* img, Viewport* viewport) {
   img->x = viewport->w / 2 - img->w / 2;
 }
 
-void render_sprite(SDL_Renderer* renderer, SDL_Texture* sprites, int src_x, int src_y, int dest_x, int dest_y) {
-  SDL_Rect src = {.x = src_x * sprite_w / 2, .y = src_y * sprite_h / 2, .w = sprite_w / 2, .h = sprite_h / 2};
-  SDL_Rect dest = {.x = dest_x * sprite_w - vp.x, .y = dest_y * sprite_h - vp.y, .w = sprite_w, .h = sprite_h};
-  if (SDL_RenderCopy(renderer, sprites, &src, &dest) < 0)
-    error("renderCopy");
+// queues every entity in the pool, drawn between its previous & current position
+// (only those that overlap the view: the world shows under the header too)
+void render_pool(SpriteBatch* batch, SDL_Texture* sprites, Pool* pool, double alpha) {
+  float min_x = vp.x - sprite_w;
+  float min_y = vp.y - sprite_h;
+  float max_x = vp.x + vp.w;
+  float max_y = vp.y + vp.h + header_height;
+
+  // the spritesheet cell for entities that aren't animated
+  SDL_Rect cell = {.x = 1 * sprite_w / 2, .y = 3 * sprite_h / 2, .w = sprite_w / 2, .h = sprite_h / 2};
+  for (int i = 0; i < pool->count; ++i) {
+    float x = pool->x[i];
+    float y = pool->y[i];
+    if (!(pool->flags[i] & SPAWNED)) {
+      x = pool->prev_x[i] + (x - pool->prev_x[i]) * alpha;
+      y = pool->prev_y[i] + (y - pool->prev_y[i]) * alpha;
+    }
+    if (x <= min_x || x >= max_x || y <= min_y || y >= max_y)
+      continue;
+    SDL_Rect* frame = anim_frame(&atlas, pool, i);
+    if (frame)
+      render_sprite(batch, atlas.tex, frame, x, y);
+    else
+      render_sprite(batch, sprites, &cell, x, y);
+  }
+}
+
+// queues a sprite (src from the texture, scaled to sprite_w*sprite_h); it's drawn when the batch is flushed
+void render_sprite(SpriteBatch* batch, SDL_Texture* tex, SDL_Rect* src, float dest_x, float dest_y) {
+  SDL_FRect dest = {.x = dest_x - vp.x, .y = dest_y - vp.y, .w = sprite_w, .h = sprite_h};
+  SDL_Color white = {255, 255, 255, 255};
+  batch_quad(batch, tex, src, &dest, white);
+}
+
+// true if the two w*h boxes intersect
+bool overlaps(float x1, float y1, float w1, float h1, float x2, float y2, float w2, float h2) {
+  return x1 < x2 + w2 && x2 < x1 + w1 &&
+    y1 < y2 + h2 && y2 < y1 + h1;
 }
 
 // TODO: consolidate w/ above is_mouseover()
@@ -0,0 +1,162 @@
+#ifndef RED_PLANET_H
+#define RED_PLANET_H
+
+#include <stdbool.h>
+
+#include "SDL.h"
+#include "SDL_mixer.h"
+#include "pool.h"
+#include "batch.h"
+
+// entity flags
+#define DELETED 0x1
+#define PLAYER 0x2
+#define ENEMY 0x4
+#define BULLET 0x8
+#define COLLECTABLE 0x10
+#define WEAPON 0x20
+#define SPAWNED 0x40 // spawned this tick (no previous position to interpolate from)
+
+// World.buttons bits (held inputs)
+#define BUTTON_LEFT 0x1
+#define BUTTON_RIGHT 0x2
+#define BUTTON_UP 0x4
+#define BUTTON_DOWN 0x8
+
+// everything the simulation reads & writes: all of a level's entities (one
+// pool per entity type) & the little state that goes with them. Snapshots
+// (snapshot.h) & replay checksums cover exactly this
+typedef struct {
+  Pool players;
+  Pool enemies;
+  Pool bullets;
+  Pool collectables;
+  Pool weapons;
+  Uint32 buttons; // BUTTON_* held, as of the current tick
+  Uint32 rng;     // world_rand() state
+  int level;
+} World;
+
+// an input that reaches the simulation; these are what --record logs
+// (a fixed 12-byte layout, written to the log as-is)
+#define INPUT_KEY_DOWN 1
+#define INPUT_KEY_UP 2
+
+typedef struct {
+  Uint32 tick;      // applied before this tick's update()
+  Sint32 code;      // SDL_Keycode
+  Uint8 type;       // INPUT_*
+  Uint8 reserved[3];
+} InputEvent;
+
+typedef struct {
+  int x;
+  int y;
+  int w;
+  int h;
+} Viewport;
+
+typedef struct {
+  SDL_Texture* tex;
+  int x;
+  int y;
+  int w;
+  int h;
+} Image;
+
+void play_level(SDL_Window* window, SDL_Renderer* renderer);
+void load(World* world, Uint32 seed);
+void on_keydown(SDL_Event* evt, bool* is_gameover, bool* is_paused, SDL_Window* window);
+void on_key_input(SDL_Event* evt, Uint32 tick, World* world);
+void on_save_key(SDL_Keycode key, Uint32 tick, World* world);
+void apply_input(InputEvent* input, World* world);
+void update(double dt, unsigned int last_loop_time, unsigned int curr_time, World* world);
+void render(SDL_Renderer* renderer, SDL_Texture* sprites, World* world, double alpha, unsigned int elapsed);
+void unload(World* world);
+
+// game-specific functions
+int closest_entity(float x, float y, Pool* pool);
+void inflict_damage(Pool* pool, int i);
+void build_hash_job(void* data, int begin, int end);
+void move_bullets_job(void* data, int begin, int end);
+void hit_bullets_job(void* data, int begin, int end);
+int find_bullet_hit(Pool* bullets, int i, Pool* enemies);
+
+// headless simulation & benchmarks (bench.c)
+int run_bench(int num_args, char* args[]);
+int run_replay(int num_args, char* args[]);
+int run_render_bench(int num_args, char* args[]);
+
+// utility functions
+void toggle_fullscreen(SDL_Window *win);
+Uint32 world_rand(World* world);
+double calc_dist(float x1, float y1, float x2, float y2);
+int clamp(int val, int min, int max);
+bool overlaps(float x1, float y1, float w1, float h1, float x2, float y2, float w2, float h2);
+Image load_img(SDL_Renderer* renderer, char* path);
+void render_img(SDL_Renderer* renderer, Image* img);
+bool needs_redraw(SDL_Event* evt);
+void center_img(Image* img, Viewport* viewport);
+void load_level_assets();
+void invalidate_render_targets();
+void free_graphics();
+bool load_map(void* data);
+void load_map_textures(void* data);
+bool load_atlas(void* data);
+void load_atlas_texture(void* data);
+void render_progress(SDL_Renderer* renderer, float progress);
+void render_pool(SpriteBatch* batch, SDL_Texture* sprites, Pool* pool, double alpha);
+void render_sprite(SpriteBatch* batch, SDL_Texture* tex, SDL_Rect* src, float dest_x, float dest_y);
+void error(char* activity);
+
+// game globals
+extern Viewport vp;
+
+extern char start_screen[];
+extern SDL_Color start_screen_bg;
+extern char spritesheet[];
+extern char atlas_path[];
+
+extern int bullet_w;
+extern int bullet_h;
+extern double bullet_speed;
+
+extern int sprite_w;
+extern int sprite_h;
+
+extern double player_speed;
+extern int camera_dead_zone_w;
+extern int camera_dead_zone_h;
+extern double camera_smoothing;
+
+extern int max_players;
+extern int max_enemies;
+extern int max_bullets;
+extern int max_collectables;
+extern int max_weapons;
+extern int max_particles;
+
+extern char script_path[];
+extern int script_budget;
+
+extern int header_height;
+
+extern int collision_cell_size;
+
+extern int audio_buffer;
+
+extern int game_width;
+extern int game_height;
+
+extern int tick_rate;
+extern int level_tick_rate;
+extern char* config_path;
+extern char* record_path;
+extern char* profile_out;
+extern char* pack_path;
+extern int num_job_threads;
+extern Arena level_arena;
+extern int max_fps;
+extern bool vsync;
+
+#endif
@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "red-planet.h"
+#include "json.h"
+#include "replay.h"
+
+static FILE* record_file = NULL;
+static ReplayHeader record_header;
+
+static Uint32 hash_bytes(Uint32 hash, void* data, size_t len);
+static Uint32 hash_pool(Uint32 hash, Pool* pool);
+
+// starts logging a level to `path`; false (with SDL_GetError() set) if it can't be written
+bool record_start(char* path, Uint32 seed) {
+  record_file = fopen(path, "wb");
+  if (!record_file) {
+    SDL_SetError("can't write %s", path);
+    return false;
+  }
+
+  record_header = (ReplayHeader){
+    .version = REPLAY_VERSION,
+    .seed = seed,
+    .tick_rate = level_tick_rate,
+    .game_width = game_width,
+    .game_height = game_height
+  };
+  memcpy(record_header.magic, REPLAY_MAGIC, 4);
+  fwrite(&record_header, sizeof(record_header), 1, record_file);
+  return true;
+}
+
+void record_input(InputEvent* input) {
+  if (!record_file)
+    return;
+
+  fwrite(input, sizeof(InputEvent), 1, record_file);
+  record_header.num_inputs++;
+}
+
+// fills in the header & closes the log
+void record_end(Uint32 num_ticks, World* world) {
+  if (!record_file)
+    return;
+
+  record_header.num_ticks = num_ticks;
+  record_header.checksum = world_checksum(world);
+  fseek(record_file, 0, SEEK_SET);
+  fwrite(&record_header, sizeof(record_header), 1, record_file);
+  if (fclose(record_file) != 0)
+    printf("writing the input log failed\n");
+  record_file = NULL;
+
+  printf("Recorded %u ticks, %u inputs (checksum %08x)\n", num_ticks, record_header.num_inputs, record_header.checksum);
+}
+
+// reads a log; returns its inputs (free them), or NULL with SDL_GetError() set
+InputEvent* replay_load(char* path, ReplayHeader* header) {
+  size_t len;
+  char* data = read_file(path, &len);
+  if (!data) {
+    SDL_SetError("can't read %s", path);
+    return NULL;
+  }
+
+  if (len < sizeof(ReplayHeader)) {
+    SDL_SetError("%s is too short to be an input log", path);
+    free(data);
+    return NULL;
+  }
+
+  memcpy(header, data, sizeof(ReplayHeader));
+  if (memcmp(header->magic, REPLAY_MAGIC, 4) != 0 || header->version != REPLAY_VERSION) {
+    SDL_SetError("%s isn't a version %d input log", path, REPLAY_VERSION);
+    free(data);
+    return NULL;
+  }
+
+  if (header->tick_rate < 1 || len < sizeof(ReplayHeader) + (size_t)header->num_inputs * sizeof(InputEvent)) {
+    SDL_SetError("%s is truncated (was the game closed while recording?)", path);
+    free(data);
+    return NULL;
+  }
+
+  // (at least 1, so an empty log still gets a valid pointer)
+  InputEvent* inputs = malloc((header->num_inputs + 1) * sizeof(InputEvent));
+  if (!inputs)
+    error("allocating replay inputs");
+  memcpy(inputs, data + sizeof(ReplayHeader), header->num_inputs * sizeof(InputEvent));
+  free(data);
+  return inputs;
+}
+
+// FNV-1a over every live entity's state (in slot order) & the world's scalars;
+// two runs that agree on this stayed in sync
+Uint32 world_checksum(World* world) {
+  Uint32 hash = 2166136261u;
+  hash = hash_pool(hash, &world->players);
+  hash = hash_pool(hash, &world->enemies);
+  hash = hash_pool(hash, &world->bullets);
+  hash = hash_pool(hash, &world->collectables);
+  hash = hash_pool(hash, &world->weapons);
+  hash = hash_bytes(hash, &world->buttons, sizeof(world->buttons));
+  hash = hash_bytes(hash, &world->rng, sizeof(world->rng));
+  return hash_bytes(hash, &world->level, sizeof(world->level));
+}
+
+static Uint32 hash_bytes(Uint32 hash, void* data, size_t len) {
+  Uint8* bytes = data;
+  for (size_t i = 0; i < len; ++i)
+    hash = (hash ^ bytes[i]) * 16777619u;
+  return hash;
+}
+
+static Uint32 hash_pool(Uint32 hash, Pool* pool) {
+  int count = pool->count;
+  hash = hash_bytes(hash, &count, sizeof(count));
+  hash = hash_bytes(hash, pool->x, count * sizeof(float));
+  hash = hash_bytes(hash, pool->y, count * sizeof(float));
+  hash = hash_bytes(hash, pool->dx, count * sizeof(float));
+  hash = hash_bytes(hash, pool->dy, count * sizeof(float));
+  hash = hash_bytes(hash, pool->flags, count * sizeof(byte));
+  hash = hash_bytes(hash, pool->health, count * sizeof(byte));
+  return hash_bytes(hash, pool->ids, count * sizeof(int));
+}
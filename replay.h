@@ -0,0 +1,39 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "SDL.h"
+#include "red-planet.h"
+
+// Input logs.
+//
+// With --record, play_level() logs every InputEvent along with the seed, tick
+// rate & game size the level ran with; when the level ends, the log gets the
+// number of ticks played & a checksum of the final world. `--replay` (bench.c)
+// reruns a log headless & compares checksums, so a captured session doubles as
+// a benchmark & a desync check. Config values the simulation reads (max_*,
+// bullet_speed, ...) aren't logged & have to match the recording's.
+//
+// Layout: a ReplayHeader, then num_inputs InputEvents, in tick order.
+
+#define REPLAY_MAGIC "RPRL"
+#define REPLAY_VERSION 2
+
+typedef struct {
+  char magic[4];
+  Uint32 version;
+  Uint32 seed;
+  Uint32 tick_rate;
+  Uint32 game_width;
+  Uint32 game_height;
+  Uint32 num_ticks;   // the rest is filled in when recording ends
+  Uint32 num_inputs;
+  Uint32 checksum;    // world_checksum() after num_ticks ticks
+} ReplayHeader;
+
+bool record_start(char* path, Uint32 seed);
+void record_input(InputEvent* input);
+void record_end(Uint32 num_ticks, World* world);
+InputEvent* replay_load(char* path, ReplayHeader* header);
+Uint32 world_checksum(World* world);
+
+#endif
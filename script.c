@@ -0,0 +1,453 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "red-planet.h"
+#include "script.h"
+
+#ifndef RP_SCRIPTING
+
+bool script_start(World* world) {
+  if (script_path[0])
+    printf("Not running %s (built without scripting, see the Makefile)\n", script_path);
+  return false;
+}
+
+void script_update(World* world, double dt) {}
+
+void script_stop() {}
+
+#else
+
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+
+#define SCRIPT_HOOK_COUNT 1000 // Lua instructions between budget checks (so the budget's granularity)
+#define SCRIPT_TASK_BLOCK 256
+#define SCRIPT_ENEMY_HEALTH 3  // what rp.spawn gives enemies (rp.set can change it)
+
+// a coroutine the scheduler resumes once per tick: an enemy's behavior, or a
+// free-running one (rp.run)
+typedef struct {
+  lua_State* co;
+  int ref;            // in the registry, to keep co alive; LUA_NOREF once it's done
+  int id;             // the enemy it drives, or -1
+  Uint32 serial;      // task_of[id] while the enemy is still this task's
+  int num_args;       // waiting on co's stack for its first turn (-1 once started)
+  bool is_preempted;  // stopped mid-turn by the budget (its next turn carries on)
+  double last_turn;   // script_time at its last finished turn
+} ScriptTask;
+
+static int api_ids(lua_State* lua);
+static int api_get(lua_State* lua);
+static int api_set(lua_State* lua);
+static int api_spawn(lua_State* lua);
+static int api_run(lua_State* lua);
+static int api_rand(lua_State* lua);
+static void add_task(lua_State* lua, int id, int fn);
+static bool run_task(int t);
+static void end_task(ScriptTask* task);
+static bool is_orphaned(ScriptTask* task);
+static void compact_tasks();
+static void preempt(lua_State* co, lua_Debug* debug);
+static Pool* check_pool(lua_State* lua, int arg);
+static int slot_of(Pool* pool, lua_State* lua, int table, int k);
+
+static const luaL_Reg api[] = {
+  {"ids", api_ids},
+  {"get", api_get},
+  {"set", api_set},
+  {"spawn", api_spawn},
+  {"run", api_run},
+  {"rand", api_rand},
+  {NULL, NULL}
+};
+
+static const char* pool_names[] = {"players", "enemies", "bullets", "collectables", "weapons", NULL};
+
+enum { FIELD_X, FIELD_Y, FIELD_DX, FIELD_DY, FIELD_HEALTH };
+static const char* field_names[] = {"x", "y", "dx", "dy", "health", NULL};
+
+static lua_State* lua = NULL; // (NULL when no script is running)
+static World* script_world = NULL;
+static double script_time = 0; // sec since the level started
+
+// tasks take turns in order; `cursor` is the next one's, so those the budget
+// cut off are first in line next tick
+static ScriptTask* tasks = NULL;
+static int num_tasks = 0;
+static int tasks_cap = 0;
+static int cursor = 0;
+static Uint32 next_serial = 1;
+static Uint32* task_of = NULL; // enemy id -> serial of its task (0 = none)
+static int task_of_cap = 0;
+
+// the turn in progress (for the budget hook)
+static lua_State* running = NULL;
+static int budget_left = 0; // Lua instructions this tick
+static bool was_preempted = false;
+
+// runs the `script` file (with the level's entities already in place)
+bool script_start(World* world) {
+  script_stop();
+  if (!script_path[0])
+    return false;
+
+  script_world = world;
+  script_time = 0;
+  next_serial = 1;
+  lua = luaL_newstate();
+  if (!lua) {
+    printf("Not running %s (out of memory)\n", script_path);
+    return false;
+  }
+  luaL_openlibs(lua);
+
+  luaL_newlib(lua, api);
+  lua_pushinteger(lua, game_width);
+  lua_setfield(lua, -2, "game_width");
+  lua_pushinteger(lua, game_height);
+  lua_setfield(lua, -2, "game_height");
+  lua_pushinteger(lua, sprite_w);
+  lua_setfield(lua, -2, "sprite_w");
+  lua_pushinteger(lua, sprite_h);
+  lua_setfield(lua, -2, "sprite_h");
+  lua_setglobal(lua, "rp");
+
+  if (luaL_loadfile(lua, script_path) != LUA_OK || lua_pcall(lua, 0, 0, 0) != LUA_OK) {
+    printf("Not running %s (%s)\n", script_path, lua_tostring(lua, -1));
+    script_stop();
+    return false;
+  }
+  return true;
+}
+
+// gives every task a turn, or as many as fit in the budget
+void script_update(World* world, double dt) {
+  if (!lua)
+    return;
+
+  script_world = world;
+  script_time += dt;
+  compact_tasks();
+
+  // (tasks started during these turns get theirs from the next tick)
+  int num = num_tasks;
+  budget_left = script_budget;
+  for (int turn = 0; turn < num; ++turn) {
+    if (script_budget && budget_left <= 0)
+      break;
+    // (a task stopped partway goes to the back of the line, so it can't
+    // take every tick's budget from the rest)
+    bool is_done = run_task(cursor);
+    cursor = (cursor + 1) % num;
+    if (!is_done)
+      break;
+  }
+}
+
+// ends the level's scripts
+void script_stop() {
+  if (lua)
+    lua_close(lua);
+  lua = NULL;
+  script_world = NULL;
+
+  // (the arrays are in the level arena)
+  tasks = NULL;
+  num_tasks = tasks_cap = cursor = 0;
+  task_of = NULL;
+  task_of_cap = 0;
+}
+
+// Lua API (the `rp` table)
+
+// rp.ids(pool [, out]) -> out, n: the ids of every live entity in the pool
+// ("players", "enemies", "bullets", "collectables" or "weapons"), in out[1..n]
+static int api_ids(lua_State* lua) {
+  Pool* pool = check_pool(lua, 1);
+  if (lua_istable(lua, 2))
+    lua_settop(lua, 2);
+  else {
+    lua_settop(lua, 1);
+    lua_createtable(lua, pool->count, 0);
+  }
+
+  int n = 0;
+  for (int i = 0; i < pool->count; ++i) {
+    if (pool->flags[i] & DELETED)
+      continue;
+    lua_pushinteger(lua, pool->ids[i]);
+    lua_rawseti(lua, 2, ++n);
+  }
+
+  // (so #out is n when out is reused)
+  for (int k = n + 1; lua_rawgeti(lua, 2, k) != LUA_TNIL; ++k) {
+    lua_pop(lua, 1);
+    lua_pushnil(lua);
+    lua_rawseti(lua, 2, k);
+  }
+  lua_pop(lua, 1);
+
+  lua_pushinteger(lua, n);
+  return 2;
+}
+
+// rp.get(pool, field, ids [, out]) -> out: out[k] = the field ("x", "y", "dx",
+// "dy" or "health") of entity ids[k], or nil if it's gone
+static int api_get(lua_State* lua) {
+  Pool* pool = check_pool(lua, 1);
+  int field = luaL_checkoption(lua, 2, NULL, field_names);
+  luaL_checktype(lua, 3, LUA_TTABLE);
+  int n = (int)lua_rawlen(lua, 3);
+  if (lua_istable(lua, 4))
+    lua_settop(lua, 4);
+  else {
+    lua_settop(lua, 3);
+    lua_createtable(lua, n, 0);
+  }
+
+  for (int k = 1; k <= n; ++k) {
+    int slot = slot_of(pool, lua, 3, k);
+    if (slot == -1)
+      lua_pushnil(lua);
+    else if (field == FIELD_HEALTH)
+      lua_pushinteger(lua, pool->health[slot]);
+    else {
+      float* values[] = {pool->x, pool->y, pool->dx, pool->dy};
+      lua_pushnumber(lua, values[field][slot]);
+    }
+    lua_rawseti(lua, 4, k);
+  }
+  return 1;
+}
+
+// rp.set(pool, field, ids, values): sets the field of entity ids[k] to
+// values[k] (skipping entities that are gone & values that aren't numbers;
+// health is kept to 1-255)
+static int api_set(lua_State* lua) {
+  Pool* pool = check_pool(lua, 1);
+  int field = luaL_checkoption(lua, 2, NULL, field_names);
+  luaL_checktype(lua, 3, LUA_TTABLE);
+  luaL_checktype(lua, 4, LUA_TTABLE);
+  int n = (int)lua_rawlen(lua, 3);
+
+  for (int k = 1; k <= n; ++k) {
+    int slot = slot_of(pool, lua, 3, k);
+    int is_num;
+    lua_rawgeti(lua, 4, k);
+    lua_Number value = lua_tonumberx(lua, -1, &is_num);
+    lua_pop(lua, 1);
+    if (slot == -1 || !is_num)
+      continue;
+
+    if (field == FIELD_HEALTH)
+      pool->health[slot] = value < 1 ? 1 : value > 255 ? 255 : (byte)value;
+    else {
+      float* values[] = {pool->x, pool->y, pool->dx, pool->dy};
+      values[field][slot] = value;
+    }
+  }
+  return 0;
+}
+
+// rp.spawn(x, y [, behavior, ...]) -> id: a new enemy, driven by
+// behavior(id, ...) if there is one; nil if the enemy pool is full
+static int api_spawn(lua_State* lua) {
+  float x = luaL_checknumber(lua, 1);
+  float y = luaL_checknumber(lua, 2);
+  bool has_behavior = !lua_isnoneornil(lua, 3);
+  if (has_behavior)
+    luaL_checktype(lua, 3, LUA_TFUNCTION);
+
+  Pool* enemies = &script_world->enemies;
+  int slot = pool_spawn(enemies);
+  if (slot == -1) {
+    lua_pushnil(lua);
+    return 1;
+  }
+  enemies->x[slot] = x;
+  enemies->y[slot] = y;
+  enemies->health[slot] = SCRIPT_ENEMY_HEALTH;
+
+  int id = enemies->ids[slot];
+  if (has_behavior)
+    add_task(lua, id, 3);
+  else if (id < task_of_cap)
+    task_of[id] = 0; // (in case the id's last enemy had a task)
+  lua_pushinteger(lua, id);
+  return 1;
+}
+
+// rp.run(fn, ...): runs fn(...) as a coroutine of its own, until it returns
+static int api_run(lua_State* lua) {
+  luaL_checktype(lua, 1, LUA_TFUNCTION);
+  add_task(lua, -1, 1);
+  return 0;
+}
+
+// rp.rand() -> [0, 1), from the world's random numbers (so replays match)
+static int api_rand(lua_State* lua) {
+  lua_pushnumber(lua, world_rand(script_world) * (1.0 / 4294967296.0));
+  return 1;
+}
+
+// scheduling
+
+// starts a task for the function at `fn`, passing it the id (unless it's -1)
+// & everything on the stack after fn
+static void add_task(lua_State* lua, int id, int fn) {
+  if (num_tasks == tasks_cap) {
+    int cap = tasks_cap ? tasks_cap * 2 : SCRIPT_TASK_BLOCK;
+    ScriptTask* grown = arena_alloc(&level_arena, cap * sizeof(ScriptTask));
+    if (tasks)
+      memcpy(grown, tasks, num_tasks * sizeof(ScriptTask));
+    tasks = grown;
+    tasks_cap = cap;
+  }
+
+  // task_of follows the enemy pool's growth
+  Pool* enemies = &script_world->enemies;
+  if (id >= 0 && task_of_cap < enemies->cap) {
+    Uint32* grown = arena_alloc(&level_arena, enemies->cap * sizeof(Uint32));
+    if (task_of)
+      memcpy(grown, task_of, task_of_cap * sizeof(Uint32));
+    memset(grown + task_of_cap, 0, (enemies->cap - task_of_cap) * sizeof(Uint32));
+    task_of = grown;
+    task_of_cap = enemies->cap;
+  }
+
+  int top = lua_gettop(lua);
+  lua_State* co = lua_newthread(lua);
+  lua_sethook(co, preempt, LUA_MASKCOUNT, SCRIPT_HOOK_COUNT);
+  lua_pushvalue(lua, fn);
+  if (id >= 0)
+    lua_pushinteger(lua, id);
+  for (int i = fn + 1; i <= top; ++i)
+    lua_pushvalue(lua, i);
+  int num_args = lua_gettop(lua) - top - 2;
+  lua_xmove(lua, co, num_args + 1);
+
+  ScriptTask* task = &tasks[num_tasks++];
+  task->co = co;
+  task->ref = luaL_ref(lua, LUA_REGISTRYINDEX); // (pops co)
+  task->id = id;
+  task->serial = next_serial++;
+  task->num_args = num_args;
+  task->is_preempted = false;
+  task->last_turn = script_time;
+  if (id >= 0)
+    task_of[id] = task->serial;
+}
+
+// gives tasks[t] its turn; false if the budget ran out partway through it
+static bool run_task(int t) {
+  ScriptTask* task = &tasks[t];
+  if (is_orphaned(task)) {
+    end_task(task);
+    return true;
+  }
+
+  int num_args = 0;
+  if (task->num_args >= 0) {
+    num_args = task->num_args;
+    task->num_args = -1;
+  }
+  else if (!task->is_preempted) {
+    lua_pushnumber(task->co, script_time - task->last_turn);
+    num_args = 1;
+  }
+
+  running = task->co;
+  was_preempted = false;
+  int num_results;
+  int status = lua_resume(task->co, lua, num_args, &num_results);
+  running = NULL;
+
+  // (the turn can spawn tasks, which can move the array)
+  task = &tasks[t];
+  if (status == LUA_YIELD) {
+    lua_pop(task->co, num_results);
+    task->is_preempted = was_preempted;
+    if (!was_preempted)
+      task->last_turn = script_time;
+    return !was_preempted;
+  }
+
+  if (status != LUA_OK) {
+    luaL_traceback(lua, task->co, lua_tostring(task->co, -1), 0);
+    printf("Script error: %s\n", lua_tostring(lua, -1));
+    lua_pop(lua, 1);
+  }
+  end_task(task);
+  return true;
+}
+
+static void end_task(ScriptTask* task) {
+  if (task->ref == LUA_NOREF)
+    return;
+  luaL_unref(lua, LUA_REGISTRYINDEX, task->ref);
+  task->ref = LUA_NOREF;
+  task->co = NULL;
+  if (task->id >= 0 && task_of[task->id] == task->serial)
+    task_of[task->id] = 0;
+}
+
+// its enemy died (or the id has gone to another enemy since)
+static bool is_orphaned(ScriptTask* task) {
+  if (task->id < 0)
+    return false;
+  Pool* enemies = &script_world->enemies;
+  return task->id >= enemies->cap || enemies->slots[task->id] == -1 || task_of[task->id] != task->serial;
+}
+
+// drops finished & orphaned tasks, keeping the order (& the cursor's place in it)
+static void compact_tasks() {
+  int num = 0;
+  int new_cursor = -1;
+  for (int t = 0; t < num_tasks; ++t) {
+    if (t == cursor)
+      new_cursor = num;
+    if (is_orphaned(&tasks[t]))
+      end_task(&tasks[t]);
+    if (tasks[t].ref != LUA_NOREF)
+      tasks[num++] = tasks[t];
+  }
+  num_tasks = num;
+  cursor = new_cursor == -1 || new_cursor >= num ? 0 : new_cursor;
+}
+
+// count hook (every SCRIPT_HOOK_COUNT instructions): charges them to the
+// budget & stops the running turn once it's spent (it's resumed from there on
+// the task's next turn). Coroutines the task started itself (which inherit the
+// hook) are charged but not stopped, since that would look to the task like
+// they'd yielded
+static void preempt(lua_State* co, lua_Debug* debug) {
+  if (!running || !script_budget)
+    return;
+  budget_left -= SCRIPT_HOOK_COUNT;
+  if (co != running || budget_left > 0 || !lua_isyieldable(co))
+    return;
+  was_preempted = true;
+  lua_yield(co, 0);
+}
+
+static Pool* check_pool(lua_State* lua, int arg) {
+  Pool* pools[] = {&script_world->players, &script_world->enemies, &script_world->bullets, &script_world->collectables, &script_world->weapons};
+  return pools[luaL_checkoption(lua, arg, NULL, pool_names)];
+}
+
+// slot of the entity whose id is table[k], or -1 if it's gone (or not an id)
+static int slot_of(Pool* pool, lua_State* lua, int table, int k) {
+  int is_num;
+  lua_rawgeti(lua, table, k);
+  lua_Integer id = lua_tointegerx(lua, -1, &is_num);
+  lua_pop(lua, 1);
+  if (!is_num || id < 0 || id >= pool->cap)
+    return -1;
+  int slot = pool->slots[id];
+  return slot == -1 || (pool->flags[slot] & DELETED) ? -1 : slot;
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <stdbool.h>
+
+#include "red-planet.h"
+
+// Lua scripts for enemy behavior (built with `make SCRIPTING=1`, Lua 5.4).
+//
+// The `script` config file runs when a level starts; it places enemies with
+// rp.spawn(x, y, behavior, ...), which starts behavior(id, ...) as a coroutine
+// for that enemy, and can start free-running ones (waves, directors) with
+// rp.run(fn, ...). Every tick, each coroutine is resumed once and runs until
+// it yields; coroutine.yield() returns the sec since its last turn. An
+// enemy's coroutine is dropped when the enemy dies.
+//
+// Entity state is read & written in bulk, one call per field for a whole
+// list of ids (rp.ids, rp.get, rp.set; see script.c), so a behavior that
+// steers a whole squad crosses into C a few times per tick rather than once
+// per entity per field.
+//
+// Scripts share a budget of Lua instructions per tick (script_budget). Once
+// it's spent, the coroutines that haven't had their turn wait for the next
+// tick, and one that's still running is stopped mid-turn (between Lua
+// instructions) and carries on from there on its next turn, so a slow script
+// delays enemies rather than frames. The budget counts instructions rather
+// than time so that how far the scripts get is the same on every machine, and
+// sessions replay exactly; scripts use rp.rand() (the world's random numbers)
+// to stay reproducible too.
+//
+// The scripts' own state (their coroutines) isn't part of the World: loading a
+// save keeps the coroutines whose enemies still exist & drops the rest.
+// Without RP_SCRIPTING, these do nothing (& a `script` in the config is ignored).
+
+bool script_start(World* world);
+void script_update(World* world, double dt);
+void script_stop();
+
+#endif
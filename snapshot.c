@@ -0,0 +1,317 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "red-planet.h"
+#include "snapshot.h"
+
+// sections start 8-byte aligned
+#define ALIGN8(n) (((n) + 7) & ~(size_t)7)
+#define HEADER_LEN ALIGN8(sizeof(SnapshotHeader))
+
+typedef struct {
+  char magic[4];
+  Uint32 version;
+  Uint32 base_len;  // of the snapshot it applies to
+  Uint32 len;       // of the snapshot it rebuilds
+  Uint32 num_runs;
+} DeltaHeader;
+
+// consecutive changed blocks; their bytes follow
+typedef struct {
+  Uint32 first;
+  Uint32 num;
+} DeltaRun;
+
+// a pool field: `num` of its `size`-byte elements are live
+#define MAX_FIELDS 14
+
+typedef struct {
+  void* data;
+  size_t size;
+  int num;
+} Field;
+
+static void list_pools(World* world, Pool* pools[]);
+static int list_fields(Pool* pool, SnapshotPool* counts, Field fields[]);
+static size_t layout_len(Pool* pools[], SnapshotHeader* header);
+static bool is_block_changed(Snapshot* snap, Snapshot* base, size_t b);
+static bool check_runs(Snapshot* delta, DeltaHeader* header);
+static void reserve(Snapshot* snap, size_t len);
+
+// copies the world's state into `snap` (replacing whatever it held)
+void snapshot_take(Snapshot* snap, World* world) {
+  Pool* pools[SNAPSHOT_POOLS];
+  list_pools(world, pools);
+
+  SnapshotHeader header = {
+    .version = SNAPSHOT_VERSION,
+    .buttons = world->buttons,
+    .rng = world->rng,
+    .level = world->level
+  };
+  memcpy(header.magic, SNAPSHOT_MAGIC, 4);
+  for (int p = 0; p < SNAPSHOT_POOLS; ++p)
+    header.pools[p] = (SnapshotPool){pools[p]->cap, pools[p]->count, pools[p]->num_free, pools[p]->max};
+  header.len = layout_len(pools, &header);
+
+  // if the buffer holds a snapshot with the same layout, only what was live
+  // then & isn't now needs zeroing; otherwise start from a zeroed buffer
+  SnapshotHeader old;
+  bool is_same_layout = snap->len == header.len;
+  if (is_same_layout) {
+    memcpy(&old, snap->data, sizeof(old));
+    is_same_layout = memcmp(old.magic, SNAPSHOT_MAGIC, 4) == 0;
+    for (int p = 0; p < SNAPSHOT_POOLS; ++p)
+      is_same_layout &= old.pools[p].cap == header.pools[p].cap;
+  }
+  if (!is_same_layout) {
+    reserve(snap, header.len);
+    memset(snap->data, 0, header.len);
+    snap->len = header.len;
+  }
+  memcpy(snap->data, &header, sizeof(header));
+
+  Uint8* section = snap->data + HEADER_LEN;
+  for (int p = 0; p < SNAPSHOT_POOLS; ++p) {
+    Field fields[MAX_FIELDS];
+    Field old_fields[MAX_FIELDS];
+    int num_fields = list_fields(pools[p], &header.pools[p], fields);
+    if (is_same_layout)
+      list_fields(pools[p], &old.pools[p], old_fields);
+
+    for (int f = 0; f < num_fields; ++f) {
+      size_t size = fields[f].size;
+      memcpy(section, fields[f].data, fields[f].num * size);
+      if (is_same_layout && old_fields[f].num > fields[f].num)
+        memset(section + fields[f].num * size, 0, (old_fields[f].num - fields[f].num) * size);
+      section += ALIGN8(header.pools[p].cap * size);
+    }
+  }
+}
+
+// puts the world back the way it was when `snap` was taken; false (with
+// SDL_GetError() set, & the world untouched) if it can't be
+bool snapshot_restore(Snapshot* snap, World* world) {
+  SnapshotHeader header;
+  if (snap->len < HEADER_LEN) {
+    SDL_SetError("not a world snapshot");
+    return false;
+  }
+  memcpy(&header, snap->data, sizeof(header));
+  if (memcmp(header.magic, SNAPSHOT_MAGIC, 4) != 0 || header.version != SNAPSHOT_VERSION || header.len != snap->len) {
+    SDL_SetError("not a version %d world snapshot", SNAPSHOT_VERSION);
+    return false;
+  }
+
+  Pool* pools[SNAPSHOT_POOLS];
+  list_pools(world, pools);
+  for (int p = 0; p < SNAPSHOT_POOLS; ++p) {
+    SnapshotPool* counts = &header.pools[p];
+    if (counts->max != pools[p]->max) {
+      SDL_SetError("the pool limits (max_*) have changed since the snapshot was taken");
+      return false;
+    }
+    // every id is either live or free
+    if (counts->cap < 0 || counts->cap > counts->max || counts->count < 0 || counts->num_free < 0 || counts->count + counts->num_free != counts->cap) {
+      SDL_SetError("corrupt world snapshot");
+      return false;
+    }
+  }
+  if (layout_len(pools, &header) != header.len) {
+    SDL_SetError("corrupt world snapshot");
+    return false;
+  }
+
+  Uint8* section = snap->data + HEADER_LEN;
+  for (int p = 0; p < SNAPSHOT_POOLS; ++p) {
+    // the arrays may end up bigger than the snapshot's cap; the pool just
+    // reallocates sooner than it has to when it next grows
+    Pool* pool = pools[p];
+    pool_reserve(pool, header.pools[p].cap);
+    pool->cap = header.pools[p].cap;
+    pool->count = header.pools[p].count;
+    pool->num_free = header.pools[p].num_free;
+
+    Field fields[MAX_FIELDS];
+    int num_fields = list_fields(pool, &header.pools[p], fields);
+    for (int f = 0; f < num_fields; ++f) {
+      memcpy(fields[f].data, section, fields[f].num * fields[f].size);
+      section += ALIGN8(pool->cap * fields[f].size);
+    }
+  }
+
+  world->buttons = header.buttons;
+  world->rng = header.rng;
+  world->level = header.level;
+  return true;
+}
+
+// stores in `delta` the blocks of `snap` that differ from `base` (an earlier
+// snapshot, or any other one)
+void snapshot_delta(Snapshot* delta, Snapshot* snap, Snapshot* base) {
+  DeltaHeader header = {
+    .version = SNAPSHOT_VERSION,
+    .base_len = base->len,
+    .len = snap->len
+  };
+  memcpy(header.magic, SNAPSHOT_DELTA_MAGIC, 4);
+  reserve(delta, sizeof(header));
+  delta->len = sizeof(header);
+
+  size_t num_blocks = snap->len / SNAPSHOT_BLOCK;
+  size_t b = 0;
+  while (b < num_blocks) {
+    if (!is_block_changed(snap, base, b)) {
+      ++b;
+      continue;
+    }
+
+    DeltaRun run = {.first = b};
+    while (b < num_blocks && is_block_changed(snap, base, b))
+      ++b;
+    run.num = b - run.first;
+
+    size_t bytes = run.num * SNAPSHOT_BLOCK;
+    reserve(delta, delta->len + sizeof(run) + bytes);
+    memcpy(delta->data + delta->len, &run, sizeof(run));
+    memcpy(delta->data + delta->len + sizeof(run), snap->data + run.first * SNAPSHOT_BLOCK, bytes);
+    delta->len += sizeof(run) + bytes;
+    header.num_runs++;
+  }
+  memcpy(delta->data, &header, sizeof(header));
+}
+
+// turns `snap`, which must hold the delta's base, into the snapshot the delta
+// was made from; false (with SDL_GetError() set, & snap untouched) if it can't
+bool snapshot_apply(Snapshot* snap, Snapshot* delta) {
+  DeltaHeader header;
+  if (delta->len < sizeof(header)) {
+    SDL_SetError("not a snapshot delta");
+    return false;
+  }
+  memcpy(&header, delta->data, sizeof(header));
+  if (memcmp(header.magic, SNAPSHOT_DELTA_MAGIC, 4) != 0 || header.version != SNAPSHOT_VERSION) {
+    SDL_SetError("not a version %d snapshot delta", SNAPSHOT_VERSION);
+    return false;
+  }
+  if (snap->len != header.base_len) {
+    SDL_SetError("the delta wasn't made against this snapshot");
+    return false;
+  }
+  if (!check_runs(delta, &header)) {
+    SDL_SetError("corrupt snapshot delta");
+    return false;
+  }
+
+  // (blocks past the base's end are always in a run, so growing needs no zeroing)
+  reserve(snap, header.len);
+  snap->len = header.len;
+
+  size_t pos = sizeof(header);
+  for (Uint32 r = 0; r < header.num_runs; ++r) {
+    DeltaRun run;
+    memcpy(&run, delta->data + pos, sizeof(run));
+    size_t bytes = run.num * SNAPSHOT_BLOCK;
+    memcpy(snap->data + run.first * SNAPSHOT_BLOCK, delta->data + pos + sizeof(run), bytes);
+    pos += sizeof(run) + bytes;
+  }
+  return true;
+}
+
+void snapshot_copy(Snapshot* dst, Snapshot* src) {
+  reserve(dst, src->len);
+  memcpy(dst->data, src->data, src->len);
+  dst->len = src->len;
+}
+
+void snapshot_free(Snapshot* snap) {
+  free(snap->data);
+  *snap = (Snapshot){};
+}
+
+// in the order they're laid out (the same as world_checksum()'s)
+static void list_pools(World* world, Pool* pools[]) {
+  pools[0] = &world->players;
+  pools[1] = &world->enemies;
+  pools[2] = &world->bullets;
+  pools[3] = &world->collectables;
+  pools[4] = &world->weapons;
+}
+
+// the pool's fields & how many elements of each are live, given these counts
+static int list_fields(Pool* pool, SnapshotPool* counts, Field fields[]) {
+  int n = 0;
+  fields[n++] = (Field){pool->x, sizeof(float), counts->count};
+  fields[n++] = (Field){pool->y, sizeof(float), counts->count};
+  fields[n++] = (Field){pool->prev_x, sizeof(float), counts->count};
+  fields[n++] = (Field){pool->prev_y, sizeof(float), counts->count};
+  fields[n++] = (Field){pool->dx, sizeof(float), counts->count};
+  fields[n++] = (Field){pool->dy, sizeof(float), counts->count};
+  fields[n++] = (Field){pool->anim_time, sizeof(float), counts->count};
+  fields[n++] = (Field){pool->ids, sizeof(int), counts->count};
+  fields[n++] = (Field){pool->slots, sizeof(int), counts->cap};
+  fields[n++] = (Field){pool->free_ids, sizeof(int), counts->num_free};
+  fields[n++] = (Field){pool->flags, sizeof(byte), counts->count};
+  fields[n++] = (Field){pool->health, sizeof(byte), counts->count};
+  fields[n++] = (Field){pool->anim, sizeof(byte), counts->count};
+  fields[n++] = (Field){pool->anim_step, sizeof(byte), counts->count};
+  return n;
+}
+
+// bytes in a snapshot of pools with the header's caps (whole blocks, so deltas
+// never deal in partial ones)
+static size_t layout_len(Pool* pools[], SnapshotHeader* header) {
+  size_t len = HEADER_LEN;
+  for (int p = 0; p < SNAPSHOT_POOLS; ++p) {
+    Field fields[MAX_FIELDS];
+    int num_fields = list_fields(pools[p], &header->pools[p], fields);
+    for (int f = 0; f < num_fields; ++f)
+      len += ALIGN8(header->pools[p].cap * fields[f].size);
+  }
+  return (len + SNAPSHOT_BLOCK - 1) / SNAPSHOT_BLOCK * SNAPSHOT_BLOCK;
+}
+
+// (blocks the base doesn't have count as changed)
+static bool is_block_changed(Snapshot* snap, Snapshot* base, size_t b) {
+  size_t offset = b * SNAPSHOT_BLOCK;
+  return offset + SNAPSHOT_BLOCK > base->len || memcmp(snap->data + offset, base->data + offset, SNAPSHOT_BLOCK) != 0;
+}
+
+// every run fits in both the delta & the snapshot it rebuilds, & together
+// they cover whatever that snapshot has past the base's end
+static bool check_runs(Snapshot* delta, DeltaHeader* header) {
+  if (header->len % SNAPSHOT_BLOCK)
+    return false;
+
+  size_t num_blocks = header->len / SNAPSHOT_BLOCK;
+  size_t base_blocks = header->base_len / SNAPSHOT_BLOCK;
+  size_t covered = base_blocks; // blocks [0, covered) have contents
+  size_t pos = sizeof(DeltaHeader);
+  for (Uint32 r = 0; r < header->num_runs; ++r) {
+    DeltaRun run;
+    if (pos + sizeof(run) > delta->len)
+      return false;
+    memcpy(&run, delta->data + pos, sizeof(run));
+    size_t bytes = (size_t)run.num * SNAPSHOT_BLOCK;
+    if (run.first > num_blocks || run.num > num_blocks - run.first || pos + sizeof(run) + bytes > delta->len)
+      return false;
+    if (run.first <= covered && run.first + run.num > covered)
+      covered = run.first + run.num;
+    pos += sizeof(run) + bytes;
+  }
+  return covered >= num_blocks;
+}
+
+// makes room for `len` bytes, keeping what's there
+static void reserve(Snapshot* snap, size_t len) {
+  if (len <= snap->cap)
+    return;
+
+  size_t cap = snap->cap * 2 > len ? snap->cap * 2 : len;
+  Uint8* data = realloc(snap->data, cap);
+  if (!data)
+    error("allocating snapshot");
+  snap->data = data;
+  snap->cap = cap;
+}
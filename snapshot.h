@@ -0,0 +1,64 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "SDL.h"
+#include "red-planet.h"
+
+// World snapshots, for save states, rewind & replay seeking.
+//
+// A snapshot is one flat buffer: a SnapshotHeader (the world's scalars & each
+// pool's cap & counts) followed by a section per pool field. Sections are sized
+// by the pool's cap, so they only move when a pool grows; only the live part of
+// each one ([0, count), the free ids, the id table) is copied, and the rest is
+// kept zeroed. Taking or restoring one is a memcpy per field.
+//
+// A delta keeps just the SNAPSHOT_BLOCK-byte blocks of a snapshot that differ
+// from an earlier one (its base); applying it to a copy of the base rebuilds
+// the later snapshot. From one tick to the next most blocks don't change, so
+// e.g. a rewind buffer can keep a full snapshot every so often & a delta
+// every tick in between.
+//
+// Snapshots are tied to the pool limits they were taken with: restoring one
+// into a world whose max_* have changed since fails.
+
+#define SNAPSHOT_MAGIC "RPSS"
+#define SNAPSHOT_DELTA_MAGIC "RPSD"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BLOCK 256
+#define SNAPSHOT_POOLS 5 // players, enemies, bullets, collectables, weapons
+
+typedef struct {
+  Sint32 cap;
+  Sint32 count;
+  Sint32 num_free;
+  Sint32 max;
+} SnapshotPool;
+
+typedef struct {
+  char magic[4];
+  Uint32 version;
+  Uint32 len;       // of the whole snapshot, in bytes
+  Uint32 buttons;
+  Uint32 rng;
+  Sint32 level;
+  SnapshotPool pools[SNAPSHOT_POOLS];
+} SnapshotHeader;
+
+// a snapshot or a delta; the buffer is reused (& only grows) from one to the next
+typedef struct {
+  Uint8* data;
+  size_t len;
+  size_t cap;
+} Snapshot;
+
+void snapshot_take(Snapshot* snap, World* world);
+bool snapshot_restore(Snapshot* snap, World* world);
+void snapshot_delta(Snapshot* delta, Snapshot* snap, Snapshot* base);
+bool snapshot_apply(Snapshot* snap, Snapshot* delta);
+void snapshot_copy(Snapshot* dst, Snapshot* src);
+void snapshot_free(Snapshot* snap);
+
+#endif
@@ -0,0 +1,393 @@
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <limits.h>
+
+#include "spatial_hash.h"
+
+// a k-nearest search in progress: the best k so far, nearest first
+typedef struct {
+  float x;
+  float y;
+  float max_dist_sq;
+  int k;
+  int num;
+  int* out;
+  float dist_sq[MAX_NEAREST];
+} Nearest;
+
+static int cell_coord(float px, int cell_size);
+static int bucket_of(SpatialHash* hash, int cell_x, int cell_y);
+static bool in_bounds(SpatialHash* hash, int cell_x, int cell_y);
+static bool in_cell(SpatialHash* hash, Pool* pool, int i, int cell_x, int cell_y);
+static void search_cell(SpatialHash* hash, Pool* pool, int cell_x, int cell_y, Nearest* nearest);
+static float slab_time(float from, float delta, float edge);
+static void reserve(SpatialHash* hash, int num_buckets, int num_entries);
+
+// rebuilds the hash over all live entities in the pool; each entity is a w*h box at its x/y
+// and is inserted into every cell that box overlaps
+void spatial_hash_build(SpatialHash* hash, int cell_size, Pool* pool, float w, float h) {
+  // count the cells covered by live entities so the buckets can be sized
+  // (and the bounds of the cells the entities' x/y are in, for distance queries)
+  int num_live = 0;
+  int num_cells = 0;
+  hash->min_cell_x = hash->min_cell_y = INT_MAX;
+  hash->max_cell_x = hash->max_cell_y = INT_MIN;
+  for (int i = 0; i < pool->count; ++i) {
+    if (pool->flags[i] & DELETED)
+      continue;
+
+    int x1 = cell_coord(pool->x[i], cell_size), x2 = cell_coord(pool->x[i] + w, cell_size);
+    int y1 = cell_coord(pool->y[i], cell_size), y2 = cell_coord(pool->y[i] + h, cell_size);
+    num_cells += (x2 - x1 + 1) * (y2 - y1 + 1);
+    num_live++;
+
+    if (x1 < hash->min_cell_x) hash->min_cell_x = x1;
+    if (x1 > hash->max_cell_x) hash->max_cell_x = x1;
+    if (y1 < hash->min_cell_y) hash->min_cell_y = y1;
+    if (y1 > hash->max_cell_y) hash->max_cell_y = y1;
+  }
+
+  // ~2 buckets per live entity keeps hash collisions (false candidates) rare
+  int num_buckets = 16;
+  while (num_buckets < num_live * 2)
+    num_buckets *= 2;
+
+  reserve(hash, num_buckets, num_cells);
+  hash->cell_size = cell_size;
+  hash->num_buckets = num_buckets;
+  hash->num_entries = num_cells;
+
+  // counting sort: bucket sizes -> prefix sums -> scatter
+  int* start = hash->bucket_start;
+  memset(start, 0, (num_buckets + 1) * sizeof(int));
+  for (int i = 0; i < pool->count; ++i) {
+    if (pool->flags[i] & DELETED)
+      continue;
+
+    int x1 = cell_coord(pool->x[i], cell_size), x2 = cell_coord(pool->x[i] + w, cell_size);
+    int y1 = cell_coord(pool->y[i], cell_size), y2 = cell_coord(pool->y[i] + h, cell_size);
+    for (int cy = y1; cy <= y2; ++cy)
+      for (int cx = x1; cx <= x2; ++cx)
+        start[bucket_of(hash, cx, cy) + 1]++;
+  }
+
+  for (int b = 0; b < num_buckets; ++b)
+    start[b + 1] += start[b];
+
+  // scatter, using bucket_start[b] as a cursor & then shifting it back
+  for (int i = 0; i < pool->count; ++i) {
+    if (pool->flags[i] & DELETED)
+      continue;
+
+    int x1 = cell_coord(pool->x[i], cell_size), x2 = cell_coord(pool->x[i] + w, cell_size);
+    int y1 = cell_coord(pool->y[i], cell_size), y2 = cell_coord(pool->y[i] + h, cell_size);
+    for (int cy = y1; cy <= y2; ++cy)
+      for (int cx = x1; cx <= x2; ++cx)
+        hash->entries[start[bucket_of(hash, cx, cy)]++] = i;
+  }
+
+  for (int b = num_buckets; b > 0; --b)
+    start[b] = start[b - 1];
+  start[0] = 0;
+}
+
+// writes the indices of entities that may overlap the w*h box at x/y into `out`
+// returns the number of candidates written (at most max_out); candidates can
+// contain duplicates & false positives, so callers still do an exact overlap test
+int spatial_hash_query(SpatialHash* hash, float x, float y, float w, float h, int out[], int max_out) {
+  if (!hash->num_entries)
+    return 0;
+
+  int x1 = cell_coord(x, hash->cell_size), x2 = cell_coord(x + w, hash->cell_size);
+  int y1 = cell_coord(y, hash->cell_size), y2 = cell_coord(y + h, hash->cell_size);
+
+  int num_out = 0;
+  for (int cy = y1; cy <= y2; ++cy) {
+    for (int cx = x1; cx <= x2; ++cx) {
+      int b = bucket_of(hash, cx, cy);
+      for (int e = hash->bucket_start[b]; e < hash->bucket_start[b + 1]; ++e) {
+        if (num_out == max_out)
+          return num_out;
+        out[num_out++] = hash->entries[e];
+      }
+    }
+  }
+  return num_out;
+}
+
+// the slot of the live entity whose x/y is closest to x/y and at most max_dist
+// away (INFINITY for no limit), or -1 if there isn't one
+int spatial_hash_nearest(SpatialHash* hash, Pool* pool, float x, float y, float max_dist) {
+  int slot;
+  return spatial_hash_k_nearest(hash, pool, x, y, max_dist, 1, &slot) ? slot : -1;
+}
+
+// writes the slots of the (up to) k live entities closest to x/y & at most
+// max_dist away into `out`, nearest first; returns how many were written
+int spatial_hash_k_nearest(SpatialHash* hash, Pool* pool, float x, float y, float max_dist, int k, int out[]) {
+  if (!hash->num_entries || k < 1)
+    return 0;
+
+  Nearest nearest = {.x = x, .y = y, .max_dist_sq = max_dist * max_dist, .k = k < MAX_NEAREST ? k : MAX_NEAREST, .out = out};
+  int cs = hash->cell_size;
+  int cx = cell_coord(x, cs);
+  int cy = cell_coord(y, cs);
+
+  // search rings of cells around x/y's cell (ring r = the cells r away)
+  for (int r = 0; ; ++r) {
+    // every entity is inside the rings already searched
+    if (cx - r < hash->min_cell_x && cx + r > hash->max_cell_x && cy - r < hash->min_cell_y && cy + r > hash->max_cell_y)
+      break;
+
+    // nothing in this ring (or beyond) can be closer than the edge of the last one
+    if (r > 0) {
+      float edge_x = fminf(x - (float)(cx - r + 1) * cs, (float)(cx + r) * cs - x);
+      float edge_y = fminf(y - (float)(cy - r + 1) * cs, (float)(cy + r) * cs - y);
+      float edge = fminf(edge_x, edge_y);
+      if (edge * edge > nearest.max_dist_sq || (nearest.num == nearest.k && edge * edge >= nearest.dist_sq[nearest.k - 1]))
+        break;
+    }
+
+    for (int i = -r; i <= r; ++i) {
+      search_cell(hash, pool, cx + i, cy - r, &nearest);
+      if (r > 0)
+        search_cell(hash, pool, cx + i, cy + r, &nearest);
+    }
+    for (int i = -r + 1; i < r; ++i) {
+      search_cell(hash, pool, cx - r, cy + i, &nearest);
+      search_cell(hash, pool, cx + r, cy + i, &nearest);
+    }
+  }
+  return nearest.num;
+}
+
+// writes the slots of live entities whose x/y is within `radius` of x/y into
+// `out`, in no particular order; returns how many were written (at most max_out)
+int spatial_hash_radius(SpatialHash* hash, Pool* pool, float x, float y, float radius, int out[], int max_out) {
+  if (!hash->num_entries)
+    return 0;
+
+  // only the cells that hold entities (so a huge radius doesn't walk empty space)
+  int cs = hash->cell_size;
+  int x1 = cell_coord(fmaxf(x - radius, (float)hash->min_cell_x * cs), cs);
+  int x2 = cell_coord(fminf(x + radius, (float)hash->max_cell_x * cs), cs);
+  int y1 = cell_coord(fmaxf(y - radius, (float)hash->min_cell_y * cs), cs);
+  int y2 = cell_coord(fminf(y + radius, (float)hash->max_cell_y * cs), cs);
+  float radius_sq = radius * radius;
+
+  int num_out = 0;
+  for (int cy = y1; cy <= y2; ++cy) {
+    for (int cx = x1; cx <= x2; ++cx) {
+      int b = bucket_of(hash, cx, cy);
+      for (int e = hash->bucket_start[b]; e < hash->bucket_start[b + 1]; ++e) {
+        int i = hash->entries[e];
+        if ((pool->flags[i] & DELETED) || !in_cell(hash, pool, i, cx, cy))
+          continue;
+
+        float dx = pool->x[i] - x;
+        float dy = pool->y[i] - y;
+        if (dx * dx + dy * dy > radius_sq)
+          continue;
+
+        if (num_out == max_out)
+          return num_out;
+        out[num_out++] = i;
+      }
+    }
+  }
+  return num_out;
+}
+
+// the slot of the first live entity (a w*h box at its x/y) that a mover_w*mover_h
+// box moving in a straight line from x0/y0 to x1/y1 hits, with how far along
+// (0-1) it hits in *hit_t; -1 if it gets there without hitting anything.
+// (Of several hits at the same time, the first found wins; cells & buckets are
+// always searched in the same order, so that's deterministic)
+int spatial_hash_sweep(SpatialHash* hash, Pool* pool, float w, float h, float x0, float y0, float x1, float y1, float mover_w, float mover_h, float* hit_t) {
+  if (!hash->num_entries)
+    return -1;
+
+  // the mover's top-left corner steps through the grid cell by cell; at each
+  // step the cells its box overlaps while the corner is in that cell are
+  // searched. Any entity hit at time t is in a cell the box overlaps at t, so
+  // once the corner reaches cells it only enters after the best hit so far,
+  // nothing can beat that hit
+  int cell_size = hash->cell_size;
+  float dx = x1 - x0;
+  float dy = y1 - y0;
+  int cx = cell_coord(x0, cell_size);
+  int cy = cell_coord(y0, cell_size);
+  int end_cx = cell_coord(x1, cell_size);
+  int end_cy = cell_coord(y1, cell_size);
+  int step_x = dx > 0 ? 1 : -1;
+  int step_y = dy > 0 ? 1 : -1;
+
+  // time (0-1 along the path) at which the corner crosses the next cell edge
+  // on each axis, & between edges
+  float next_x = dx != 0 ? slab_time(x0, dx, (cx + (dx > 0)) * (float)cell_size) : INFINITY;
+  float next_y = dy != 0 ? slab_time(y0, dy, (cy + (dy > 0)) * (float)cell_size) : INFINITY;
+  float delta_x = dx != 0 ? cell_size / fabsf(dx) : INFINITY;
+  float delta_y = dy != 0 ? cell_size / fabsf(dy) : INFINITY;
+
+  int best = -1;
+  float best_t = INFINITY;
+  float enter_t = 0; // when the corner entered the current cell
+  int num_steps = abs(end_cx - cx) + abs(end_cy - cy) + 1;
+  for (int s = 0; s < num_steps; ++s) {
+    // the box's extent while the corner is in this cell
+    float exit_t = fminf(fminf(next_x, next_y), 1);
+    float ax = x0 + dx * enter_t, bx = x0 + dx * exit_t;
+    float ay = y0 + dy * enter_t, by = y0 + dy * exit_t;
+    int x1_cell = cell_coord(fminf(ax, bx), cell_size), x2_cell = cell_coord(fmaxf(ax, bx) + mover_w, cell_size);
+    int y1_cell = cell_coord(fminf(ay, by), cell_size), y2_cell = cell_coord(fmaxf(ay, by) + mover_h, cell_size);
+    if (cx < x1_cell) x1_cell = cx; // (in case rounding put the corner a cell off)
+    if (cy < y1_cell) y1_cell = cy;
+
+    for (int y = y1_cell; y <= y2_cell; ++y) {
+      for (int x = x1_cell; x <= x2_cell; ++x) {
+        int b = bucket_of(hash, x, y);
+        for (int e = hash->bucket_start[b]; e < hash->bucket_start[b + 1]; ++e) {
+          int i = hash->entries[e];
+          float t;
+          if ((pool->flags[i] & DELETED) || !sweep_box(x0, y0, x1, y1, mover_w, mover_h, pool->x[i], pool->y[i], w, h, &t) || t >= best_t)
+            continue;
+          best = i;
+          best_t = t;
+          if (t == 0) { // (overlapping from the start: nothing can come first)
+            *hit_t = 0;
+            return best;
+          }
+        }
+      }
+    }
+
+    // on to whichever cell edge comes first
+    float entry = next_x < next_y ? next_x : next_y;
+    if (entry > best_t || entry > 1)
+      break;
+    enter_t = entry;
+    if (next_x < next_y) {
+      cx += step_x;
+      next_x += delta_x;
+    }
+    else {
+      cy += step_y;
+      next_y += delta_y;
+    }
+  }
+
+  if (best != -1)
+    *hit_t = best_t;
+  return best;
+}
+
+// swept AABB: whether a mover_w*mover_h box moving from x0/y0 to x1/y1 overlaps
+// the w*h box at x/y on the way (overlaps() is exclusive, so touching doesn't
+// count), & if so the first time (0-1) it does in *hit_t
+bool sweep_box(float x0, float y0, float x1, float y1, float mover_w, float mover_h, float x, float y, float w, float h, float* hit_t) {
+  // (the box grown by the mover's size, which the mover's corner can't be inside)
+  float lo_x = x - mover_w, hi_x = x + w;
+  float lo_y = y - mover_h, hi_y = y + h;
+  float dx = x1 - x0;
+  float dy = y1 - y0;
+
+  float enter = -INFINITY, exit = INFINITY;
+  if (dx != 0) {
+    float t1 = slab_time(x0, dx, lo_x), t2 = slab_time(x0, dx, hi_x);
+    enter = fmaxf(enter, fminf(t1, t2));
+    exit = fminf(exit, fmaxf(t1, t2));
+  }
+  else if (x0 <= lo_x || x0 >= hi_x)
+    return false;
+
+  if (dy != 0) {
+    float t1 = slab_time(y0, dy, lo_y), t2 = slab_time(y0, dy, hi_y);
+    enter = fmaxf(enter, fminf(t1, t2));
+    exit = fminf(exit, fmaxf(t1, t2));
+  }
+  else if (y0 <= lo_y || y0 >= hi_y)
+    return false;
+
+  if (enter >= exit || enter >= 1 || exit <= 0)
+    return false;
+  *hit_t = enter > 0 ? enter : 0;
+  return true;
+}
+
+void spatial_hash_free(SpatialHash* hash) {
+  free(hash->bucket_start);
+  free(hash->entries);
+  memset(hash, 0, sizeof(SpatialHash));
+}
+
+// floor (not truncation), so negative coords don't share cell 0 with positive ones
+static int cell_coord(float px, int cell_size) {
+  return (int)floorf(px / cell_size);
+}
+
+static int bucket_of(SpatialHash* hash, int cell_x, int cell_y) {
+  unsigned int h = (unsigned int)cell_x * 73856093u ^ (unsigned int)cell_y * 19349663u;
+  return h & (hash->num_buckets - 1);
+}
+
+static bool in_bounds(SpatialHash* hash, int cell_x, int cell_y) {
+  return cell_x >= hash->min_cell_x && cell_x <= hash->max_cell_x && cell_y >= hash->min_cell_y && cell_y <= hash->max_cell_y;
+}
+
+// whether entity i's x/y is in the cell; entities are inserted into every cell
+// their box overlaps (& buckets are shared by several cells), so distance
+// queries only count an entity in its own cell, which also means only once
+static bool in_cell(SpatialHash* hash, Pool* pool, int i, int cell_x, int cell_y) {
+  return cell_coord(pool->x[i], hash->cell_size) == cell_x && cell_coord(pool->y[i], hash->cell_size) == cell_y;
+}
+
+// adds any of the cell's entities that are among the k nearest so far
+static void search_cell(SpatialHash* hash, Pool* pool, int cell_x, int cell_y, Nearest* nearest) {
+  if (!in_bounds(hash, cell_x, cell_y))
+    return;
+
+  int b = bucket_of(hash, cell_x, cell_y);
+  for (int e = hash->bucket_start[b]; e < hash->bucket_start[b + 1]; ++e) {
+    int i = hash->entries[e];
+    if ((pool->flags[i] & DELETED) || !in_cell(hash, pool, i, cell_x, cell_y))
+      continue;
+
+    float dx = pool->x[i] - nearest->x;
+    float dy = pool->y[i] - nearest->y;
+    float dist_sq = dx * dx + dy * dy;
+    if (dist_sq > nearest->max_dist_sq || (nearest->num == nearest->k && dist_sq >= nearest->dist_sq[nearest->k - 1]))
+      continue;
+
+    // insertion sort (dropping the farthest when there are already k)
+    int j = nearest->num < nearest->k ? nearest->num++ : nearest->k - 1;
+    for (; j > 0 && nearest->dist_sq[j - 1] > dist_sq; --j) {
+      nearest->dist_sq[j] = nearest->dist_sq[j - 1];
+      nearest->out[j] = nearest->out[j - 1];
+    }
+    nearest->dist_sq[j] = dist_sq;
+    nearest->out[j] = i;
+  }
+}
+
+// when (0-1 along a move of `delta` from `from`) the edge at `edge` is reached
+static float slab_time(float from, float delta, float edge) {
+  return (edge - from) / delta;
+}
+
+// grows (never shrinks) the bucket & entry arrays, so steady-state rebuilds don't allocate
+static void reserve(SpatialHash* hash, int num_buckets, int num_entries) {
+  if (num_buckets > hash->max_buckets) {
+    hash->bucket_start = realloc(hash->bucket_start, (num_buckets + 1) * sizeof(int));
+    if (!hash->bucket_start)
+      error("allocating spatial hash buckets");
+    hash->max_buckets = num_buckets;
+  }
+
+  if (num_entries > hash->max_entries) {
+    hash->entries = realloc(hash->entries, num_entries * sizeof(int));
+    if (!hash->entries)
+      error("allocating spatial hash entries");
+    hash->max_entries = num_entries;
+  }
+}
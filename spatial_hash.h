@@ -0,0 +1,48 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include "red-planet.h"
+
+// Uniform-grid spatial hash used as the collision broad phase.
+//
+// The world is divided into square cells of `cell_size` px; each cell hashes
+// into one of `num_buckets` buckets. The hash is rebuilt from scratch every
+// tick with a counting sort, so building is O(n) and there is no per-entity
+// allocation. Entries are entity slots in the pool that was hashed.
+//
+// The same hash answers distance queries (nearest, k nearest & within a
+// radius) about the entities' x/y positions. These search outward from the
+// query point cell by cell, so they only look at entities near it; they use
+// the positions & slots the pool had when the hash was built, and skip any
+// entity that's been marked DELETED since.
+//
+// Fast movers (bullets) use spatial_hash_sweep() instead of overlap queries,
+// so they can't tunnel through anything between ticks: it walks the cells
+// along the mover's path in order (a DDA grid traversal) & tests the entities
+// in them against the box swept from its old position to its new one.
+#define MAX_NEAREST 64 // most entities a single k-nearest query can return
+
+typedef struct {
+  int cell_size;
+  int num_buckets;    // always a power of 2
+  int* bucket_start;  // num_buckets + 1 offsets into entries
+  int* entries;       // entity indices, grouped by bucket
+  int num_entries;
+  int max_buckets;
+  int max_entries;
+  int min_cell_x;     // bounds of the cells holding an entity's x/y
+  int min_cell_y;
+  int max_cell_x;
+  int max_cell_y;
+} SpatialHash;
+
+void spatial_hash_build(SpatialHash* hash, int cell_size, Pool* pool, float w, float h);
+int spatial_hash_query(SpatialHash* hash, float x, float y, float w, float h, int out[], int max_out);
+int spatial_hash_nearest(SpatialHash* hash, Pool* pool, float x, float y, float max_dist);
+int spatial_hash_k_nearest(SpatialHash* hash, Pool* pool, float x, float y, float max_dist, int k, int out[]);
+int spatial_hash_radius(SpatialHash* hash, Pool* pool, float x, float y, float radius, int out[], int max_out);
+int spatial_hash_sweep(SpatialHash* hash, Pool* pool, float w, float h, float x0, float y0, float x1, float y1, float mover_w, float mover_h, float* hit_t);
+bool sweep_box(float x0, float y0, float x1, float y1, float mover_w, float mover_h, float x, float y, float w, float h, float* hit_t);
+void spatial_hash_free(SpatialHash* hash);
+
+#endif
@@ -0,0 +1,205 @@
+#include <string.h>
+
+#include "SDL.h"
+#include "font8x8_basic.h"
+#include "red-planet.h"
+#include "text.h"
+
+// Bitmap text, drawn from a glyph atlas baked once from font8x8_basic.
+//
+// The 128 glyphs are laid out 16 per row in a 128x64 white-on-transparent
+// texture. A string is drawn as one textured quad per glyph, all submitted
+// with a single SDL_RenderGeometry() call, and tinted with the renderer's
+// current draw color.
+
+#define GLYPH_SIZE 8
+#define ATLAS_COLS 16
+#define ATLAS_ROWS 8
+#define MAX_BATCH_GLYPHS 128
+
+static SDL_Texture* glyph_atlas = NULL;
+static SDL_Renderer* atlas_renderer = NULL;
+
+static SDL_Texture* get_glyph_atlas(SDL_Renderer* renderer);
+static int draw_glyphs(SDL_Renderer* renderer, char str[], int offset_x, int offset_y, int size, SDL_Color color);
+static void bake_text(SDL_Renderer* renderer, CachedText* text, char str[]);
+
+// draws the string in the current draw color; returns its width in px
+int render_text(SDL_Renderer* renderer, char str[], int offset_x, int offset_y, int size) {
+  SDL_Color color;
+  if (SDL_GetRenderDrawColor(renderer, &color.r, &color.g, &color.b, &color.a) < 0)
+    error("getting text color");
+
+  return draw_glyphs(renderer, str, offset_x, offset_y, size, color);
+}
+
+// like render_text(), but draws from a texture that is only rebuilt when `str` changes
+int render_cached_text(SDL_Renderer* renderer, CachedText* text, char str[], int offset_x, int offset_y, int size) {
+  if (text->renderer != renderer || strncmp(text->str, str, MAX_CACHED_TEXT) != 0)
+    bake_text(renderer, text, str);
+
+  // no render-target support (or an empty string): draw it uncached
+  if (!text->tex)
+    return render_text(renderer, str, offset_x, offset_y, size);
+
+  SDL_Color color;
+  if (SDL_GetRenderDrawColor(renderer, &color.r, &color.g, &color.b, &color.a) < 0)
+    error("getting text color");
+  if (SDL_SetTextureColorMod(text->tex, color.r, color.g, color.b) < 0 ||
+    SDL_SetTextureAlphaMod(text->tex, color.a) < 0)
+    error("setting text color");
+
+  SDL_Rect dest = {.x = offset_x, .y = offset_y, .w = text->w * size, .h = text->h * size};
+  if (SDL_RenderCopy(renderer, text->tex, NULL, &dest) < 0)
+    error("renderCopy");
+
+  return text->w * size;
+}
+
+// re-renders the text the next time it's drawn (render target contents are
+// lost when the renderer's device is reset); the texture itself is reused
+void text_invalidate(CachedText* text) {
+  text->str[0] = '\0';
+}
+
+void free_cached_text(CachedText* text) {
+  if (text->tex)
+    SDL_DestroyTexture(text->tex);
+  memset(text, 0, sizeof(CachedText));
+}
+
+// must be called before the atlas's renderer is destroyed
+void free_glyph_atlas() {
+  if (glyph_atlas)
+    SDL_DestroyTexture(glyph_atlas);
+  glyph_atlas = NULL;
+  atlas_renderer = NULL;
+}
+
+// bakes the font into the atlas the first time it's needed for a renderer
+static SDL_Texture* get_glyph_atlas(SDL_Renderer* renderer) {
+  if (glyph_atlas && atlas_renderer == renderer)
+    return glyph_atlas;
+
+  Uint32 pixels[ATLAS_ROWS * GLYPH_SIZE][ATLAS_COLS * GLYPH_SIZE] = {};
+  for (int code = 0; code < 128; ++code) {
+    int atlas_x = (code % ATLAS_COLS) * GLYPH_SIZE;
+    int atlas_y = (code / ATLAS_COLS) * GLYPH_SIZE;
+    for (int y = 0; y < GLYPH_SIZE; ++y)
+      for (int x = 0; x < GLYPH_SIZE; ++x)
+        if (font8x8_basic[code][y] & 1 << x)
+          pixels[atlas_y + y][atlas_x + x] = 0xFFFFFFFF;
+  }
+
+  glyph_atlas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, ATLAS_COLS * GLYPH_SIZE, ATLAS_ROWS * GLYPH_SIZE);
+  if (!glyph_atlas)
+    error("creating glyph atlas");
+  if (SDL_UpdateTexture(glyph_atlas, NULL, pixels, sizeof(pixels[0])) < 0)
+    error("uploading glyph atlas");
+  if (SDL_SetTextureBlendMode(glyph_atlas, SDL_BLENDMODE_BLEND) < 0)
+    error("setting glyph atlas blend mode");
+
+  atlas_renderer = renderer;
+  return glyph_atlas;
+}
+
+// one quad per glyph, flushed in batches of MAX_BATCH_GLYPHS
+static int draw_glyphs(SDL_Renderer* renderer, char str[], int offset_x, int offset_y, int size, SDL_Color color) {
+  SDL_Texture* atlas = get_glyph_atlas(renderer);
+  SDL_Vertex verts[MAX_BATCH_GLYPHS * 4];
+  int indices[MAX_BATCH_GLYPHS * 6];
+  int num_glyphs = 0;
+
+  float u_step = 1.0f / ATLAS_COLS;
+  float v_step = 1.0f / ATLAS_ROWS;
+  float glyph_px = GLYPH_SIZE * size;
+
+  int i;
+  for (i = 0; str[i] != '\0'; ++i) {
+    int code = str[i];
+    if (code < 0 || code > 127)
+      error("Text code out of range");
+
+    float x = offset_x + i * glyph_px;
+    float y = offset_y;
+    float u = (code % ATLAS_COLS) * u_step;
+    float v = (code / ATLAS_COLS) * v_step;
+
+    SDL_Vertex* vert = &verts[num_glyphs * 4];
+    vert[0] = (SDL_Vertex){{x, y}, color, {u, v}};
+    vert[1] = (SDL_Vertex){{x + glyph_px, y}, color, {u + u_step, v}};
+    vert[2] = (SDL_Vertex){{x + glyph_px, y + glyph_px}, color, {u + u_step, v + v_step}};
+    vert[3] = (SDL_Vertex){{x, y + glyph_px}, color, {u, v + v_step}};
+
+    int* index = &indices[num_glyphs * 6];
+    int base = num_glyphs * 4;
+    index[0] = base; index[1] = base + 1; index[2] = base + 2;
+    index[3] = base; index[4] = base + 2; index[5] = base + 3;
+
+    if (++num_glyphs == MAX_BATCH_GLYPHS) {
+      if (SDL_RenderGeometry(renderer, atlas, verts, num_glyphs * 4, indices, num_glyphs * 6) < 0)
+        error("drawing text");
+      num_glyphs = 0;
+    }
+  }
+
+  if (num_glyphs && SDL_RenderGeometry(renderer, atlas, verts, num_glyphs * 4, indices, num_glyphs * 6) < 0)
+    error("drawing text");
+
+  // width of total text string
+  return i * size * GLYPH_SIZE;
+}
+
+// renders the string (white, size 1) into the cache's texture
+static void bake_text(SDL_Renderer* renderer, CachedText* text, char str[]) {
+  if (text->renderer != renderer)
+    free_cached_text(text);
+
+  text->renderer = renderer;
+  strncpy(text->str, str, MAX_CACHED_TEXT - 1);
+  text->str[MAX_CACHED_TEXT - 1] = '\0';
+
+  int w = strlen(text->str) * GLYPH_SIZE;
+  int h = GLYPH_SIZE;
+
+  // only reallocate the texture when the string's length changes
+  if (text->tex && text->w != w) {
+    SDL_DestroyTexture(text->tex);
+    text->tex = NULL;
+  }
+  text->w = w;
+  text->h = h;
+  if (!w)
+    return;
+
+  if (!text->tex) {
+    text->tex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, w, h);
+    if (!text->tex)
+      return;
+    if (SDL_SetTextureBlendMode(text->tex, SDL_BLENDMODE_BLEND) < 0)
+      error("setting text blend mode");
+  }
+
+  SDL_Color prev_color;
+  SDL_GetRenderDrawColor(renderer, &prev_color.r, &prev_color.g, &prev_color.b, &prev_color.a);
+  SDL_Texture* prev_target = SDL_GetRenderTarget(renderer);
+
+  if (SDL_SetRenderTarget(renderer, text->tex) < 0) {
+    SDL_DestroyTexture(text->tex);
+    text->tex = NULL;
+    return;
+  }
+
+  if (SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0) < 0)
+    error("setting text bg color");
+  if (SDL_RenderClear(renderer) < 0)
+    error("clearing text texture");
+
+  SDL_Color white = {255, 255, 255, 255};
+  draw_glyphs(renderer, text->str, 0, 0, 1, white);
+
+  if (SDL_SetRenderTarget(renderer, prev_target) < 0)
+    error("restoring render target");
+  if (SDL_SetRenderDrawColor(renderer, prev_color.r, prev_color.g, prev_color.b, prev_color.a) < 0)
+    error("restoring draw color");
+}
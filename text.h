@@ -0,0 +1,25 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include "SDL.h"
+
+#define MAX_CACHED_TEXT 64
+
+// A string pre-rendered (white, 1px per font pixel) into its own texture.
+// It's only re-rendered when the string changes; color & size are applied
+// when it's drawn, so changing them is free.
+typedef struct {
+  char str[MAX_CACHED_TEXT];
+  SDL_Texture* tex;
+  SDL_Renderer* renderer;
+  int w;
+  int h;
+} CachedText;
+
+int render_text(SDL_Renderer* renderer, char str[], int offset_x, int offset_y, int size);
+int render_cached_text(SDL_Renderer* renderer, CachedText* text, char str[], int offset_x, int offset_y, int size);
+void text_invalidate(CachedText* text);
+void free_cached_text(CachedText* text);
+void free_glyph_atlas();
+
+#endif
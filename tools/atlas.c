@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "SDL_image.h"
+#include "../anim.h"
+
+// Builds a texture atlas: packs animation frames (PNGs or anything SDL_image
+// reads) into one square power-of-2 image & writes a metadata table with every
+// frame's rect and every animation's frames & durations (see anim.h).
+//
+// Frames follow the --anim they belong to; FRAME:MS gives a frame its
+// duration (100 ms if left out) & --once makes the animation hold its last
+// frame instead of looping. A frame used more than once is only packed once.
+//
+// usage: atlas OUT.png OUT.json [--max-size PX] [--anim NAME [--once] FRAME[:MS]...]...
+//
+// e.g. atlas example/atlas.png example/atlas.json --anim player art/walk1.png art/walk2.png:150
+
+#define PADDING 1 // transparent px between frames, so filtering doesn't bleed
+
+typedef struct {
+  char* path;
+  SDL_Surface* surface;
+  int x;
+  int y;
+} Frame;
+
+static Frame frames[MAX_ATLAS_FRAMES];
+static int num_frames = 0;
+static Animation anims[MAX_ANIMS];
+static int num_anims = 0;
+
+static void fail(char* activity) {
+  fprintf(stderr, "%s failed: %s\n", activity, SDL_GetError());
+  exit(1);
+}
+
+static void usage() {
+  fprintf(stderr, "usage: atlas OUT.png OUT.json [--max-size PX] [--anim NAME [--once] FRAME[:MS]...]...\n");
+  exit(1);
+}
+
+// the frame's index, loading it the first time it's seen
+static int add_frame(char* path) {
+  for (int f = 0; f < num_frames; ++f)
+    if (strcmp(frames[f].path, path) == 0)
+      return f;
+
+  if (num_frames == MAX_ATLAS_FRAMES) {
+    fprintf(stderr, "more than %d frames\n", MAX_ATLAS_FRAMES);
+    exit(1);
+  }
+  SDL_Surface* img = IMG_Load(path);
+  if (!img)
+    fail(path);
+  frames[num_frames].surface = SDL_ConvertSurfaceFormat(img, SDL_PIXELFORMAT_ARGB8888, 0);
+  if (!frames[num_frames].surface)
+    fail("converting image");
+  SDL_FreeSurface(img);
+  frames[num_frames].path = path;
+  return num_frames++;
+}
+
+static int compare_heights(const void* a, const void* b) {
+  SDL_Surface* sa = frames[*(const int*)a].surface;
+  SDL_Surface* sb = frames[*(const int*)b].surface;
+  return sb->h - sa->h;
+}
+
+// shelf packing, tallest first; false if the frames don't fit in size*size
+static bool pack(int size, int order[]) {
+  int x = 0, y = 0, shelf_h = 0;
+  for (int i = 0; i < num_frames; ++i) {
+    Frame* frame = &frames[order[i]];
+    int w = frame->surface->w + PADDING;
+    int h = frame->surface->h + PADDING;
+    if (x + w > size) {
+      x = 0;
+      y += shelf_h;
+      shelf_h = 0;
+    }
+    if (x + w > size || y + h > size)
+      return false;
+
+    frame->x = x;
+    frame->y = y;
+    x += w;
+    if (h > shelf_h)
+      shelf_h = h;
+  }
+  return true;
+}
+
+int main(int num_args, char* args[]) {
+  if (num_args < 3)
+    usage();
+
+  int max_size = 4096;
+  Animation* anim = NULL;
+  for (int i = 3; i < num_args; ++i) {
+    if (strcmp(args[i], "--max-size") == 0 && i + 1 < num_args)
+      max_size = atoi(args[++i]);
+    else if (strcmp(args[i], "--anim") == 0 && i + 1 < num_args) {
+      if (num_anims == MAX_ANIMS || strlen(args[i + 1]) >= MAX_ANIM_NAME) {
+        fprintf(stderr, "%s: too many animations or name too long\n", args[i + 1]);
+        return 1;
+      }
+      anim = &anims[num_anims++];
+      strcpy(anim->name, args[++i]);
+      anim->loop = true;
+    }
+    else if (strcmp(args[i], "--once") == 0 && anim)
+      anim->loop = false;
+    else if (args[i][0] != '-' && anim) {
+      if (anim->num_frames == MAX_ANIM_FRAMES) {
+        fprintf(stderr, "%s: more than %d frames\n", anim->name, MAX_ANIM_FRAMES);
+        return 1;
+      }
+
+      // FRAME[:MS] (a colon followed by anything but digits is part of the path)
+      int ms = 100;
+      char* colon = strrchr(args[i], ':');
+      if (colon && colon[1] && strspn(colon + 1, "0123456789") == strlen(colon + 1)) {
+        ms = atoi(colon + 1);
+        *colon = '\0';
+      }
+      anim->frames[anim->num_frames] = add_frame(args[i]);
+      anim->durations[anim->num_frames] = ms < 1 ? 1 : ms > 65535 ? 65535 : ms;
+      anim->num_frames++;
+    }
+    else
+      usage();
+  }
+  if (!num_frames) {
+    fprintf(stderr, "no frames\n");
+    return 1;
+  }
+
+  // the smallest power-of-2 square they fit in
+  int order[MAX_ATLAS_FRAMES];
+  for (int f = 0; f < num_frames; ++f)
+    order[f] = f;
+  qsort(order, num_frames, sizeof(int), compare_heights);
+  int size = 64;
+  while (!pack(size, order)) {
+    size *= 2;
+    if (size > max_size) {
+      fprintf(stderr, "frames don't fit in %dx%d (--max-size)\n", max_size, max_size);
+      return 1;
+    }
+  }
+
+  SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0, size, size, 32, SDL_PIXELFORMAT_ARGB8888);
+  if (!atlas)
+    fail("creating atlas");
+  for (int f = 0; f < num_frames; ++f) {
+    SDL_SetSurfaceBlendMode(frames[f].surface, SDL_BLENDMODE_NONE);
+    SDL_Rect dest = {.x = frames[f].x, .y = frames[f].y};
+    if (SDL_BlitSurface(frames[f].surface, NULL, atlas, &dest) < 0)
+      fail("copying frame");
+  }
+  if (IMG_SavePNG(atlas, args[1]) < 0)
+    fail("writing atlas");
+
+  FILE* file = fopen(args[2], "w");
+  if (!file) {
+    perror(args[2]);
+    return 1;
+  }
+
+  fprintf(file, "{\n  \"image\": \"%s\",\n  \"frames\": [\n", args[1]);
+  for (int f = 0; f < num_frames; ++f)
+    fprintf(file, "    [%d, %d, %d, %d]%s\n", frames[f].x, frames[f].y, frames[f].surface->w, frames[f].surface->h, f + 1 < num_frames ? "," : "");
+  fprintf(file, "  ],\n  \"animations\": {\n");
+  for (int a = 0; a < num_anims; ++a) {
+    fprintf(file, "    \"%s\": {\"loop\": %s, \"frames\": [", anims[a].name, anims[a].loop ? "true" : "false");
+    for (int f = 0; f < anims[a].num_frames; ++f)
+      fprintf(file, "%s%d", f ? ", " : "", anims[a].frames[f]);
+    fprintf(file, "], \"durations\": [");
+    for (int f = 0; f < anims[a].num_frames; ++f)
+      fprintf(file, "%s%d", f ? ", " : "", anims[a].durations[f]);
+    fprintf(file, "]}%s\n", a + 1 < num_anims ? "," : "");
+  }
+  fprintf(file, "  }\n}\n");
+
+  if (ferror(file) | fclose(file)) {
+    perror(args[2]);
+    return 1;
+  }
+
+  printf("%s: %d frames, %d animations, %dx%d\n", args[1], num_frames, num_anims, size, size);
+  SDL_FreeSurface(atlas);
+  for (int f = 0; f < num_frames; ++f)
+    SDL_FreeSurface(frames[f].surface);
+  return 0;
+}
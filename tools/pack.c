@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+#include "SDL_image.h"
+#include "../assets.h"
+
+// Builds an asset pack: decodes each image, converts it to PACK_FORMAT & writes
+// the raw pixels behind an index (see assets.h). Images are named by the path
+// given on the command line, which must match the path the game loads them by.
+//
+// usage: pack OUT.pak IMAGE...
+
+static void fail(char* activity) {
+  fprintf(stderr, "%s failed: %s\n", activity, SDL_GetError());
+  exit(1);
+}
+
+static Uint64 align(Uint64 offset) {
+  return (offset + PACK_ALIGN - 1) & ~(Uint64)(PACK_ALIGN - 1);
+}
+
+int main(int num_args, char* args[]) {
+  if (num_args < 3) {
+    fprintf(stderr, "usage: pack OUT.pak IMAGE...\n");
+    return 1;
+  }
+
+  int num_images = num_args - 2;
+  char** paths = args + 2;
+  SDL_Surface** surfaces = calloc(num_images, sizeof(SDL_Surface*));
+  PackEntry* entries = calloc(num_images, sizeof(PackEntry));
+  if (!surfaces || !entries) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  Uint64 offset = align(sizeof(PackHeader) + num_images * sizeof(PackEntry));
+  for (int i = 0; i < num_images; ++i) {
+    if (strlen(paths[i]) >= MAX_ASSET_PATH) {
+      fprintf(stderr, "%s: path longer than %d chars\n", paths[i], MAX_ASSET_PATH - 1);
+      return 1;
+    }
+
+    SDL_Surface* img = IMG_Load(paths[i]);
+    if (!img)
+      fail(paths[i]);
+    surfaces[i] = SDL_ConvertSurfaceFormat(img, PACK_FORMAT, 0);
+    if (!surfaces[i])
+      fail("converting image");
+    SDL_FreeSurface(img);
+
+    PackEntry* entry = &entries[i];
+    strcpy(entry->name, paths[i]);
+    entry->format = PACK_FORMAT;
+    entry->w = surfaces[i]->w;
+    entry->h = surfaces[i]->h;
+    entry->pitch = entry->w * 4;
+    entry->offset = offset;
+    offset = align(offset + (Uint64)entry->pitch * entry->h);
+  }
+
+  FILE* file = fopen(args[1], "wb");
+  if (!file) {
+    perror(args[1]);
+    return 1;
+  }
+
+  PackHeader header = {.magic = PACK_MAGIC, .version = PACK_VERSION, .num_entries = num_images};
+  fwrite(&header, sizeof(header), 1, file);
+  fwrite(entries, sizeof(PackEntry), num_images, file);
+
+  static const Uint8 zeros[PACK_ALIGN] = {};
+  for (int i = 0; i < num_images; ++i) {
+    fwrite(zeros, 1, entries[i].offset - ftell(file), file);
+
+    // surface rows may be padded; pack rows are tight
+    SDL_Surface* surface = surfaces[i];
+    if (SDL_MUSTLOCK(surface))
+      SDL_LockSurface(surface);
+    for (Uint32 y = 0; y < entries[i].h; ++y)
+      fwrite((Uint8*)surface->pixels + y * surface->pitch, entries[i].pitch, 1, file);
+    if (SDL_MUSTLOCK(surface))
+      SDL_UnlockSurface(surface);
+
+    printf("%-40s %4ux%-4u @ %llu\n", entries[i].name, entries[i].w, entries[i].h, (unsigned long long)entries[i].offset);
+    SDL_FreeSurface(surface);
+  }
+
+  if (ferror(file) | fclose(file)) {
+    perror(args[1]);
+    return 1;
+  }
+
+  free(surfaces);
+  free(entries);
+  return 0;
+}